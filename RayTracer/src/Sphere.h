@@ -9,6 +9,8 @@ public:
 
 	virtual bool Hit(const Ray& r, double t_min, double t_max, Hit_Record& rec) const override;
 	virtual bool Bounding_Box(AABB& output_box) const override;
+	virtual bool Occluded(const Ray& r, double t_min, double t_max) const override;
+	virtual void Translate(const Vec3f& offset) override { centre += offset; }
 
 public:
 	Point3f centre;
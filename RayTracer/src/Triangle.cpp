@@ -2,43 +2,20 @@
 
 bool Triangle::Hit(const Ray& r, double t_min, double t_max, Hit_Record& rec) const
 {
-    float thit, t, u, v;
-
-    Vec3f v0v1 = v1 - v0;
-    Vec3f v0v2 = v2 - v0;
-    Vec3f pvec = r.Direction().crossProduct(v0v2);
-
-    float det = pvec.dotProduct(v0v1);
-    float kEpsilon = 0.00001;
-
-    if (det < kEpsilon) {
-        return false;
-    }
-    float invDet = 1 / det;
-    
-    Vec3f tvec = r.Origin() - v0;
-    u = tvec.dotProduct(pvec) * invDet;
-    if (u < 0 || u > 1) {
-        return false;
-    }
-
-    Vec3f qvec = tvec.crossProduct(v0v1);
-    v = r.Direction().dotProduct(qvec) * invDet;
-    if (v < 0 || u + v > 1) {
-        return false;
-    }
-    t = v0v2.dotProduct(qvec) * invDet;
-    if (t < 0) {
+    float t, u, v;
+    if (!Intersect(r, static_cast<float>(t_min), static_cast<float>(t_max), t, u, v)) {
         return false;
     }
-    rec.p = r.At(t);
-    rec.t = t;
-    rec.normal = this->v1n * u + this->v2n * v + this->v0n * (1.0f - u - v);
-    rec.mat_ptr = mat_ptr;
-
+    Fill_Record(r, t, u, v, rec);
     return true;
 }
 
+bool Triangle::Occluded(const Ray& r, double t_min, double t_max) const
+{
+    float t, u, v;
+    return Intersect(r, static_cast<float>(t_min), static_cast<float>(t_max), t, u, v);
+}
+
 bool Triangle::Bounding_Box(AABB& output_box) const
 {
     float min[3];
@@ -52,3 +29,17 @@ bool Triangle::Bounding_Box(AABB& output_box) const
     return true;
 }
 
+void Triangle::Translate(const Vec3f& offset)
+{
+    //  Edges and normal are unchanged by a translation
+    v0 += offset;
+    v1 += offset;
+    v2 += offset;
+}
+
+void Triangle::Precompute()
+{
+    e1 = v1 - v0;
+    e2 = v2 - v0;
+    normal = e1.crossProduct(e2);
+}
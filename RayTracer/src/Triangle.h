@@ -10,17 +10,68 @@ public:
 		: v0(vert0), v1(vert1), v2(vert2), v0n(vert0n), v1n(vert1n), v2n(vert2n), mat_ptr(mat), mat_index(m_idx)
 	{
 		id = 2;
+		Precompute();
 	};
 
 	Triangle(Point3f vert0, Point3f vert1, Point3f vert2, std::shared_ptr<Material> mat)
-		: v0(vert0), v1(vert1), v2(vert2),mat_ptr(mat) { id = 2; };
+		: v0(vert0), v1(vert1), v2(vert2),mat_ptr(mat) { id = 2; Precompute(); };
 
 	virtual bool Hit(const Ray& r, double t_min, double t_max, Hit_Record& rec) const override;
 	virtual bool Bounding_Box(AABB& output_box) const override;
+	virtual bool Occluded(const Ray& r, double t_min, double t_max) const override;
+	virtual void Translate(const Vec3f& offset) override;
+
+	//	Intersection without touching a Hit_Record, so tree leaves can find the closest of
+	//	several triangles and only fill the record once
+	inline bool Intersect(const Ray& r, float t_min, float t_max, float& t, float& u, float& v) const;
+	inline void Fill_Record(const Ray& r, float t, float u, float v, Hit_Record& rec) const;
+
+	//	Call after changing the vertices other than through Translate
+	void Precompute();
 
 public:
 	Point3f v0, v1, v2;
 	Point3f v0n, v1n, v2n;
 	std::shared_ptr<Material> mat_ptr;
 	int mat_index;
-};
\ No newline at end of file
+
+	//	Edges from v0 and their unnormalised cross product, set once so a ray test only
+	//	needs one cross product
+	Vec3f e1, e2;
+	Vec3f normal;
+};
+
+//	Moller-Trumbore solved with Cramer's rule against the stored normal, det is the same one
+//	sided determinant as (d x e2) . e1 so back faces are still culled
+inline bool Triangle::Intersect(const Ray& r, float t_min, float t_max, float& t, float& u, float& v) const
+{
+	const Vec3f dir = r.Direction();
+	float det = -dir.dotProduct(normal);
+	float kEpsilon = 0.00001;
+
+	if (det < kEpsilon) {
+		return false;
+	}
+	float invDet = 1 / det;
+
+	Vec3f tvec = r.Origin() - v0;
+	Vec3f qvec = tvec.crossProduct(dir);
+	u = e2.dotProduct(qvec) * invDet;
+	if (u < 0 || u > 1) {
+		return false;
+	}
+	v = -e1.dotProduct(qvec) * invDet;
+	if (v < 0 || u + v > 1) {
+		return false;
+	}
+	t = tvec.dotProduct(normal) * invDet;
+	return t >= t_min && t <= t_max;
+}
+
+inline void Triangle::Fill_Record(const Ray& r, float t, float u, float v, Hit_Record& rec) const
+{
+	rec.p = r.At(t);
+	rec.t = t;
+	rec.normal = this->v1n * u + this->v2n * v + this->v0n * (1.0f - u - v);
+	rec.mat_ptr = mat_ptr;
+}
\ No newline at end of file
@@ -16,6 +16,33 @@ AABB Surrounding_Box(AABB box0, AABB box1) {
     return {small, big};
 }
 
+AABB Enclosing_Box(const AABB& box0, const AABB& box1) {
+    Point3f small(
+        std::fmin(box0.minimum.x, box1.minimum.x),
+        std::fmin(box0.minimum.y, box1.minimum.y),
+        std::fmin(box0.minimum.z, box1.minimum.z));
+
+    Point3f big(
+        std::fmax(box0.maximum.x, box1.maximum.x),
+        std::fmax(box0.maximum.y, box1.maximum.y),
+        std::fmax(box0.maximum.z, box1.maximum.z));
+
+    return {small, big};
+}
+
+AABB Empty_Box() {
+    const float big = std::numeric_limits<float>::max();
+    return {Point3f(big, big, big), Point3f(-big, -big, -big)};
+}
+
+float AABB::Surface_Area() const {
+    Vec3f d = maximum - minimum;
+    if (d.x < 0 || d.y < 0 || d.z < 0) {
+        return 0.F;
+    }
+    return 2.F * (d.x * d.y + d.y * d.z + d.z * d.x);
+}
+
 bool AABB::Hit(const Ray& r, double t_min, double t_max) const {
     for (int a = 0; a < 3; a++) {
         auto t0 = std::fmin((minimum[a] - r.Origin()[a]) / r.Direction()[a],
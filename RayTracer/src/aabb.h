@@ -11,6 +11,9 @@ public:
 
     bool Hit(const Ray& r, double t_min, double t_max) const;
 
+    float Surface_Area() const;
+    Point3f Centroid() const { return (minimum + maximum) * 0.5F; }
+
     bool operator==(const AABB& rhs) const;
 
     bool operator!=(const AABB& rhs) const;
@@ -21,4 +24,10 @@ public:
     Point3f maximum;
 };
 
-AABB Surrounding_Box(AABB box0, AABB box1);
\ No newline at end of file
+AABB Surrounding_Box(AABB box0, AABB box1);
+
+//  Tight union of two boxes without the padding Surrounding_Box adds
+AABB Enclosing_Box(const AABB& box0, const AABB& box1);
+
+//  Inverted box that any Enclosing_Box call will replace
+AABB Empty_Box();
\ No newline at end of file
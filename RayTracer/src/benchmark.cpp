@@ -0,0 +1,129 @@
+#include "benchmark.h"
+#include "tree.h"
+#include <chrono>
+#include <iostream>
+#include <string>
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cstring>
+#endif
+
+#if defined(__linux__)
+//	Last level cache misses for this thread. L2 has no portable event, LLC misses are the
+//	closest generic counter and move the same way when node layout changes.
+class Miss_Counter {
+public:
+	Miss_Counter() {
+		perf_event_attr attr;
+		std::memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = PERF_TYPE_HARDWARE;
+		attr.config = PERF_COUNT_HW_CACHE_MISSES;
+		attr.disabled = 1;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		fd = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+	}
+
+	~Miss_Counter() {
+		if (fd >= 0) {
+			close(fd);
+		}
+	}
+
+	void Start() {
+		if (fd >= 0) {
+			ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+			ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+		}
+	}
+
+	long long Stop() {
+		long long count = -1;
+		if (fd >= 0) {
+			ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+			if (read(fd, &count, sizeof(count)) != sizeof(count)) {
+				count = -1;
+			}
+		}
+		return count;
+	}
+
+private:
+	int fd;
+};
+#else
+class Miss_Counter {
+public:
+	void Start() {}
+	long long Stop() { return -1; }
+};
+#endif
+
+std::vector<Ray> Benchmark_Rays(const Camera& cam, int count) {
+	std::vector<Ray> rays;
+	rays.reserve(count);
+	for (int i = 0; i < count; i++) {
+		Ray r = cam.Get_Ray(Random_Double(), Random_Double());
+		if (i % 2) {
+			r = Ray(r.At(Random_Double(1, 10)), Vec3f::Random(-1, 1));
+		}
+		rays.push_back(r);
+	}
+	return rays;
+}
+
+Benchmark_Result Benchmark_Hits(const Hittable& world, const std::vector<Ray>& rays, int repeats) {
+	Miss_Counter counter;
+	long hits = 0;
+
+	counter.Start();
+	auto start = std::chrono::high_resolution_clock::now();
+	for (int i = 0; i < repeats; i++) {
+		for (const auto& r : rays) {
+			Hit_Record rec;
+			hits += world.Hit(r, 0.001, infinity, rec);
+		}
+	}
+	double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	long long misses = counter.Stop();
+
+	//	Keeps the loop from being optimised away
+	if (hits < 0) {
+		std::cerr << hits;
+	}
+	return { rays.size() * repeats / ms / 1000.0, misses };
+}
+
+inline void Print_Result(const std::string& name, const Benchmark_Result& result) {
+	std::cerr << name << ": " << result.mrays_per_second << " Mrays/s, ";
+	if (result.cache_misses >= 0) {
+		std::cerr << result.cache_misses << " cache misses\n";
+	}
+	else {
+		std::cerr << "cache misses unavailable\n";
+	}
+}
+
+void Benchmark_Layouts(const Hittable_List& list, const Camera& cam) {
+	const std::vector<Ray> rays = Benchmark_Rays(cam, 100000);
+	const std::shared_ptr<Hittable> root = Build_Tree(list, SAH_BUILDER);
+
+	Print_Result("BVH_Node", Benchmark_Hits(*root, rays, 5));
+	Print_Result("Linear BVH", Benchmark_Hits(*Flatten_Tree(root, LINEAR_BVH), rays, 5));
+
+	const char* layout_names[] = { "BVH4", "BVH8", "Quantized BVH4" };
+	const int layouts[] = { WIDE_BVH4, WIDE_BVH8, QUANTIZED_BVH4 };
+	const char* order_names[] = { "depth first", "hot child", "treelet", "van Emde Boas" };
+	for (int l = 0; l < 3; l++) {
+		for (int order = DEPTH_FIRST_ORDER; order <= VAN_EMDE_BOAS_ORDER; order++) {
+			std::shared_ptr<Hittable> tree = Flatten_Tree(root, layouts[l], order);
+			Print_Result(std::string(layout_names[l]) + ", " + order_names[order], Benchmark_Hits(*tree, rays, 5));
+		}
+	}
+
+	Print_Result("Uniform grid", Benchmark_Hits(*Build_Accelerator(list, SAH_BUILDER, UNIFORM_GRID), rays, 5));
+}
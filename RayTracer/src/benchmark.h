@@ -0,0 +1,21 @@
+#pragma once
+#include <memory>
+#include <vector>
+#include "hittable.h"
+#include "hittable_list.h"
+#include "camera.h"
+
+struct Benchmark_Result {
+	double mrays_per_second;
+	long long cache_misses;		//	-1 when the counters are not available
+};
+
+//	Primary rays through random points on the image plus as many random bounce rays
+std::vector<Ray> Benchmark_Rays(const Camera& cam, int count);
+
+//	Closest hit over the rays on one thread, cache misses come from the CPU counters on Linux
+Benchmark_Result Benchmark_Hits(const Hittable& world, const std::vector<Ray>& rays, int repeats);
+
+//	Prints rays/sec and cache misses for every acceleration structure, and each node order of
+//	the wide layouts, built over the list
+void Benchmark_Layouts(const Hittable_List& list, const Camera& cam);
@@ -1,30 +1,261 @@
 #include "bvh.h"
+#include "timer.h"
+#include "enum.h"
+#include <unordered_set>
+#include <future>
+#include <thread>
 
-inline int Random_Int(int min, int max) {
-    return static_cast<int>(Random_Double(min, max + 1));
+constexpr int SAH_BINS = 16;
+constexpr size_t PARALLEL_SPAN = 4096;
+
+std::vector<BVH_Primitive> Gather_Primitives(const std::vector<std::shared_ptr<Hittable>>& objects, size_t start, size_t end) {
+    std::vector<BVH_Primitive> prims(end - start);
+
+    for (size_t i = start; i < end; i++) {
+        BVH_Primitive& prim = prims[i - start];
+        if (!objects[i]->Bounding_Box(prim.box)) {
+            std::cerr << "No bounding box in bvh_node constructor.\n";
+        }
+        prim.centroid = prim.box.Centroid();
+        prim.index = i;
+    }
+    return prims;
 }
 
-inline bool Box_Compare(const std::shared_ptr<Hittable>& a, const std::shared_ptr<Hittable>& b, int axis) {
-    AABB box_a;
-    AABB box_b;
+SAH_Split Find_SAH_Split(const std::vector<BVH_Primitive>& prims, size_t start, size_t end) {
+    SAH_Split split;
+    split.centroid_bounds = Empty_Box();
+    for (size_t i = start; i < end; i++) {
+        split.centroid_bounds = Enclosing_Box(split.centroid_bounds, AABB(prims[i].centroid, prims[i].centroid));
+    }
+
+    Vec3f extent = split.centroid_bounds.Max() - split.centroid_bounds.Min();
+    split.axis = (extent.x > extent.y && extent.x > extent.z) ? 0 : (extent.y > extent.z ? 1 : 2);
+    split.bin = -1;
+    split.cost = std::numeric_limits<float>::max();
 
-    if (!a->Bounding_Box(box_a) || !b->Bounding_Box(box_b)){
-        std::cerr << "No bounding box in bvh_node constructor.\n";
+    for (int a = 0; a < 3; a++) {
+        if (extent[a] <= 0) {
+            continue;
+        }
+        int counts[SAH_BINS] = {};
+        AABB bounds[SAH_BINS];
+        std::fill(bounds, bounds + SAH_BINS, Empty_Box());
+
+        float scale = SAH_BINS / extent[a];
+        for (size_t i = start; i < end; i++) {
+            int b = std::min(SAH_BINS - 1, static_cast<int>((prims[i].centroid[a] - split.centroid_bounds.Min()[a]) * scale));
+            counts[b]++;
+            bounds[b] = Enclosing_Box(bounds[b], prims[i].box);
+        }
+
+        //	Sweep from the right so each split only costs one pass from the left
+        AABB right_box[SAH_BINS];
+        int right_count[SAH_BINS];
+        AABB sweep = Empty_Box();
+        int count = 0;
+        for (int b = SAH_BINS - 1; b > 0; b--) {
+            sweep = Enclosing_Box(sweep, bounds[b]);
+            count += counts[b];
+            right_box[b] = sweep;
+            right_count[b] = count;
+        }
+
+        sweep = Empty_Box();
+        count = 0;
+        for (int b = 0; b < SAH_BINS - 1; b++) {
+            sweep = Enclosing_Box(sweep, bounds[b]);
+            count += counts[b];
+            if (count == 0 || right_count[b + 1] == 0) {
+                continue;
+            }
+            float cost = count * sweep.Surface_Area() + right_count[b + 1] * right_box[b + 1].Surface_Area();
+            if (cost < split.cost) {
+                split.cost = cost;
+                split.axis = a;
+                split.bin = b;
+                split.left_box = sweep;
+                split.right_box = right_box[b + 1];
+            }
+        }
+    }
+    return split;
+}
+
+size_t Partition_SAH(std::vector<BVH_Primitive>& prims, size_t start, size_t end, const SAH_Split& split) {
+    size_t mid = start + (end - start) / 2;
+    const int axis = split.axis;
+
+    if (split.bin != -1) {
+        float scale = SAH_BINS / (split.centroid_bounds.Max()[axis] - split.centroid_bounds.Min()[axis]);
+        float low = split.centroid_bounds.Min()[axis];
+        int bin = split.bin;
+        auto it = std::partition(begin(prims) + start, begin(prims) + end, [=](const BVH_Primitive& p) {
+            return std::min(SAH_BINS - 1, static_cast<int>((p.centroid[axis] - low) * scale)) <= bin;
+        });
+        mid = it - begin(prims);
+    }
+
+    //	Every centroid landed in one bin, fall back to a median split
+    if (mid == start || mid == end) {
+        mid = start + (end - start) / 2;
+        std::nth_element(begin(prims) + start, begin(prims) + mid, begin(prims) + end, [=](const BVH_Primitive& a, const BVH_Primitive& b) {
+            return a.centroid[axis] < b.centroid[axis];
+        });
+    }
+    return mid;
+}
+
+size_t Partition_SAH(std::vector<BVH_Primitive>& prims, size_t start, size_t end, int& axis) {
+    SAH_Split split = Find_SAH_Split(prims, start, end);
+    axis = split.axis;
+    return Partition_SAH(prims, start, end, split);
+}
+
+static std::shared_ptr<Hittable> Build_SAH(const std::vector<std::shared_ptr<Hittable>>& objects, std::vector<BVH_Primitive>& prims,
+    size_t start, size_t end, int parallel_depth) {
+    if (end - start == 1) {
+        return objects[prims[start].index];
+    }
+
+    int axis;
+    size_t mid = Partition_SAH(prims, start, end, axis);
+
+    auto node = std::make_shared<BVH_Node>();
+    if (parallel_depth > 0 && end - start > PARALLEL_SPAN) {
+        auto left = std::async(std::launch::async, Build_SAH, std::cref(objects), std::ref(prims), start, mid, parallel_depth - 1);
+        node->right = Build_SAH(objects, prims, mid, end, parallel_depth - 1);
+        node->left = left.get();
+    }
+    else {
+        node->left = Build_SAH(objects, prims, start, mid, 0);
+        node->right = Build_SAH(objects, prims, mid, end, 0);
     }
 
-    return box_a.Min()[axis] < box_b.Min()[axis];
+    AABB box_left, box_right;
+    node->left->Bounding_Box(box_left);
+    node->right->Bounding_Box(box_right);
+    node->box = Surrounding_Box(box_left, box_right);
+    return node;
+}
+
+int Parallel_Build_Depth() {
+    int depth = 1;
+    for (unsigned threads = std::thread::hardware_concurrency(); threads > 1; threads >>= 1) {
+        depth++;
+    }
+    return depth;
+}
+
+Hittable_List Unique_Objects(const std::vector<std::shared_ptr<Hittable>>& objects) {
+    Hittable_List list;
+    std::unordered_set<const Hittable*> seen;
+    for (const auto& object : objects) {
+        if (seen.insert(object.get()).second) {
+            list.Add(object);
+        }
+    }
+    return list;
 }
 
-bool Box_X_Compare(const std::shared_ptr<Hittable>& a, const std::shared_ptr<Hittable>& b) {
-    return Box_Compare(a, b, 0);
+static bool Is_Tree_Node(const std::shared_ptr<Hittable>& n) {
+    return n->Left() != nullptr && n->Left() != n->Right();
 }
 
-bool Box_Y_Compare(const std::shared_ptr<Hittable>& a, const std::shared_ptr<Hittable>& b) {
-    return Box_Compare(a, b, 1);
+static int Tree_Height(const std::shared_ptr<Hittable>& n) {
+    if (!Is_Tree_Node(n)) {
+        return 0;
+    }
+    return 1 + std::max(Tree_Height(n->Left()), Tree_Height(n->Right()));
 }
 
-bool Box_Z_Compare(const std::shared_ptr<Hittable>& a, const std::shared_ptr<Hittable>& b) {
-    return Box_Compare(a, b, 2);
+static void Gather_Leaves(const std::shared_ptr<Hittable>& n, std::vector<std::shared_ptr<Hittable>>& leaves) {
+    if (!Is_Tree_Node(n)) {
+        leaves.push_back(n->Left() == nullptr ? n : n->Left());
+        return;
+    }
+    Gather_Leaves(n->Left(), leaves);
+    Gather_Leaves(n->Right(), leaves);
+}
+
+static std::shared_ptr<Hittable> Build_Median(const std::vector<std::shared_ptr<Hittable>>& objects, std::vector<BVH_Primitive>& prims,
+    size_t start, size_t end) {
+    if (end - start == 1) {
+        return objects[prims[start].index];
+    }
+    AABB centroid_bounds = Empty_Box();
+    AABB box = Empty_Box();
+    for (size_t i = start; i < end; i++) {
+        centroid_bounds = Enclosing_Box(centroid_bounds, AABB(prims[i].centroid, prims[i].centroid));
+        box = Enclosing_Box(box, prims[i].box);
+    }
+    const Vec3f extent = centroid_bounds.Max() - centroid_bounds.Min();
+    const int axis = extent.x > extent.y && extent.x > extent.z ? 0 : (extent.y > extent.z ? 1 : 2);
+    const size_t mid = start + (end - start) / 2;
+    std::nth_element(begin(prims) + start, begin(prims) + mid, begin(prims) + end, [=](const BVH_Primitive& a, const BVH_Primitive& b) {
+        return a.centroid[axis] < b.centroid[axis];
+    });
+
+    auto node = std::make_shared<BVH_Node>(box);
+    node->left = Build_Median(objects, prims, start, mid);
+    node->right = Build_Median(objects, prims, mid, end);
+    return node;
+}
+
+//	A node is only descended into while its children, however unbalanced, are sure to fit in
+//	what is left of the budget once rebuilt, so the rebuild below never overflows it
+static std::shared_ptr<Hittable> Limit_Height(const std::shared_ptr<Hittable>& n, int height, int budget) {
+    if (height <= budget) {
+        return n;
+    }
+    std::vector<std::shared_ptr<Hittable>> leaves;
+    Gather_Leaves(n, leaves);
+    if (budget - 1 < Balanced_Height(leaves.size())) {
+        std::vector<BVH_Primitive> prims = Gather_Primitives(leaves, 0, leaves.size());
+        return Build_Median(leaves, prims, 0, prims.size());
+    }
+
+    AABB box;
+    n->Bounding_Box(box);
+    auto node = std::make_shared<BVH_Node>(box);
+    node->left = Limit_Height(n->Left(), Tree_Height(n->Left()), budget - 1);
+    node->right = Limit_Height(n->Right(), Tree_Height(n->Right()), budget - 1);
+    return node;
+}
+
+std::shared_ptr<Hittable> Limit_Height(const std::shared_ptr<Hittable>& root, int max_height) {
+    return Limit_Height(root, Tree_Height(root), max_height);
+}
+
+static AABB Refit_Hittable(const std::shared_ptr<Hittable>& h, int parallel_depth) {
+    AABB box;
+    if (h->id != BVH_NODE) {
+        h->Bounding_Box(box);
+        return box;
+    }
+
+    BVH_Node* node = static_cast<BVH_Node*>(h.get());
+    AABB box_left, box_right;
+    if (node->left == node->right) {
+        box_left = box_right = Refit_Hittable(node->left, 0);
+    }
+    else if (parallel_depth > 0) {
+        auto left = std::async(std::launch::async, Refit_Hittable, std::cref(node->left), parallel_depth - 1);
+        box_right = Refit_Hittable(node->right, parallel_depth - 1);
+        box_left = left.get();
+    }
+    else {
+        box_left = Refit_Hittable(node->left, 0);
+        box_right = Refit_Hittable(node->right, 0);
+    }
+    node->box = Surrounding_Box(box_left, box_right);
+    return node->box;
+}
+
+void BVH_Node::Refit() {
+    AABB box_left = Refit_Hittable(left, Parallel_Build_Depth());
+    AABB box_right = left == right ? box_left : Refit_Hittable(right, Parallel_Build_Depth());
+    box = Surrounding_Box(box_left, box_right);
 }
 
 bool BVH_Node::Bounding_Box(AABB& output_box) const {
@@ -38,42 +269,51 @@ bool BVH_Node::Hit(const Ray& r, double t_min, double t_max, Hit_Record& rec) co
     }
 
     bool hit_left = left->Hit(r, t_min, t_max, rec);
-    bool hit_right = right->Hit(r, t_min, hit_left ? rec.t : t_max, rec);
+    bool hit_right = right != left && right->Hit(r, t_min, hit_left ? rec.t : t_max, rec);
 
     return hit_left || hit_right;
 }
 
+bool BVH_Node::Occluded(const Ray& r, double t_min, double t_max) const {
+    if (!box.Hit(r, t_min, t_max)){
+        return false;
+    }
+    return left->Occluded(r, t_min, t_max) || (right != left && right->Occluded(r, t_min, t_max));
+}
+
+BVH_Node::BVH_Node(const Hittable_List& list) {
+    Timer t("BVH build time: ");
+    Build(list.objects, 0, list.objects.size());
+}
+
 BVH_Node::BVH_Node(const std::vector<std::shared_ptr<Hittable>>& src_objects, size_t start, size_t end) {
-    id = 1;
-    auto objects = src_objects;
+    Build(src_objects, start, end);
+}
 
-    int axis = Random_Int(0, 2);
-    auto comparator = (axis == 0) ? Box_X_Compare
-        : (axis == 1) ? Box_Y_Compare
-        : Box_Z_Compare;
+void BVH_Node::Build(const std::vector<std::shared_ptr<Hittable>>& src_objects, size_t start, size_t end) {
+    id = 1;
+    std::vector<BVH_Primitive> prims = Gather_Primitives(src_objects, start, end);
 
     size_t object_span = end - start;
 
     if (object_span == 1) {
-        left = right = objects[start];
+        left = right = src_objects[start];
     }
-    else if (object_span == 2) {
-        if (comparator(objects[start], objects[start + 1])) {
-            left = objects[start];
-            right = objects[start + 1];
+    else {
+        int axis;
+        size_t mid = Partition_SAH(prims, 0, object_span, axis);
+        int depth = Parallel_Build_Depth();
+
+        if (object_span > PARALLEL_SPAN) {
+            auto future = std::async(std::launch::async, Build_SAH, std::cref(src_objects), std::ref(prims), 0, mid, depth);
+            right = Build_SAH(src_objects, prims, mid, object_span, depth);
+            left = future.get();
         }
         else {
-            left = objects[start + 1];
-            right = objects[start];
+            left = Build_SAH(src_objects, prims, 0, mid, 0);
+            right = Build_SAH(src_objects, prims, mid, object_span, 0);
         }
     }
-    else {
-        std::sort(begin(objects) + start, begin(objects) + end, comparator);
-
-        auto mid = start + object_span / 2;
-        left = std::make_shared<BVH_Node>(objects, start, mid);
-        right = std::make_shared<BVH_Node>(objects, mid, end);
-    }
 
     AABB box_left, box_right;
 
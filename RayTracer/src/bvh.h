@@ -5,15 +5,72 @@
 #include <algorithm>
 #include <memory>
 
+//	Per primitive data gathered once before a build so the builder never
+//	has to call back into Hittable::Bounding_Box.
+struct BVH_Primitive {
+    AABB box;
+    Point3f centroid;
+    size_t index;
+};
+
+std::vector<BVH_Primitive> Gather_Primitives(const std::vector<std::shared_ptr<Hittable>>& objects, size_t start, size_t end);
+
+//	Best binned SAH object split of a primitive range. bin is -1 when no split was found,
+//	cost is the unnormalised SAH cost, left_box/right_box the child bounds.
+struct SAH_Split {
+    int axis;
+    int bin;
+    float cost;
+    AABB centroid_bounds;
+    AABB left_box;
+    AABB right_box;
+};
+
+SAH_Split Find_SAH_Split(const std::vector<BVH_Primitive>& prims, size_t start, size_t end);
+
+//	Binned SAH split of prims[start, end). Returns the first index of the right hand side
+//	and sets axis to the split axis.
+size_t Partition_SAH(std::vector<BVH_Primitive>& prims, size_t start, size_t end, int& axis);
+size_t Partition_SAH(std::vector<BVH_Primitive>& prims, size_t start, size_t end, const SAH_Split& split);
+
+//	How many levels of a recursive build are spawned as tasks, enough to fill every core
+int Parallel_Build_Depth();
+
+//	Relative costs of a traversal step and a primitive test, used both to end leaves during
+//	a build and to compare finished trees. Leaf triangles are tested inline without a virtual
+//	call, so a test costs less than a step.
+constexpr float SAH_TRAVERSAL_COST = 1.F;
+constexpr float SAH_INTERSECT_COST = 0.3F;
+//	A whole block of a SIMD leaf is tested for about the cost of one traversal step
+constexpr float BVH_BLOCK_INTERSECT_COST = SAH_TRAVERSAL_COST;
+
+//	Height of a balanced tree over count primitives, at most leaf_size a leaf
+inline int Balanced_Height(size_t count, size_t leaf_size = 1) {
+    int height = 0;
+    for (size_t leaves = (count + leaf_size - 1) / leaf_size; leaves > 1; leaves = (leaves + 1) / 2) {
+        height++;
+    }
+    return height;
+}
+
+//	Returns root unchanged when it is at most max_height levels deep. Otherwise the subtrees
+//	that go too deep are rebuilt as balanced median splits, keeping the rest of the tree.
+//	Layouts walked with a fixed size stack call it before flattening.
+std::shared_ptr<Hittable> Limit_Height(const std::shared_ptr<Hittable>& root, int max_height);
+
+//	One entry per distinct primitive, spatial splits can reference a primitive from several leaves
+Hittable_List Unique_Objects(const std::vector<std::shared_ptr<Hittable>>& objects);
+
 class BVH_Node : public Hittable {
 public:
     BVH_Node() { id = 1; }
     BVH_Node(AABB box) : box(box) { id = 1; }
-    BVH_Node(const Hittable_List& list) : BVH_Node(list.objects, 0, list.objects.size()) { id = 1; }
+    BVH_Node(const Hittable_List& list);
     BVH_Node(const std::vector<std::shared_ptr<Hittable>>& src_objects, size_t start, size_t end);
 
     virtual bool Hit(const Ray& r, double t_min, double t_max, Hit_Record& rec) const override;
     virtual bool Bounding_Box(AABB& output_box) const override;
+    virtual bool Occluded(const Ray& r, double t_min, double t_max) const override;
 
     virtual std::shared_ptr<Hittable> Left() const override { return left; }
     virtual std::shared_ptr<Hittable> Right() const override { return right; }
@@ -23,8 +80,14 @@ public:
     virtual void Right(std::shared_ptr<Hittable> r) { right = r; };
     virtual void Box(AABB b) { box = b; };
 
+    //  Recomputes every box bottom up after primitives have moved, the topology is kept
+    void Refit();
+
 public: 
     std::shared_ptr<Hittable> left;
     std::shared_ptr<Hittable> right;
     AABB box;
+
+private:
+    void Build(const std::vector<std::shared_ptr<Hittable>>& src_objects, size_t start, size_t end);
 };
\ No newline at end of file
@@ -0,0 +1,164 @@
+#include "bvh_stats.h"
+#include "bvh.h"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+//	Per node ratios are summed and averaged once the walk is done, so the few huge nodes near
+//	the root do not drown out the rest
+struct Stats_Totals {
+	float root_area = 0.F;
+	double overlap_sum = 0.0;
+	double empty_sum = 0.0;
+	long long leaf_depth_sum = 0;
+};
+
+inline float Volume(const AABB& box) {
+	Vec3f d = box.Max() - box.Min();
+	return std::max(0.F, d.x) * std::max(0.F, d.y) * std::max(0.F, d.z);
+}
+
+inline AABB Intersection(const AABB& a, const AABB& b) {
+	Point3f lo(std::max(a.Min().x, b.Min().x), std::max(a.Min().y, b.Min().y), std::max(a.Min().z, b.Min().z));
+	Point3f hi(std::min(a.Max().x, b.Max().x), std::min(a.Max().y, b.Max().y), std::min(a.Max().z, b.Max().z));
+	if (lo.x > hi.x || lo.y > hi.y || lo.z > hi.z) {
+		return AABB();
+	}
+	return AABB(lo, hi);
+}
+
+inline void Add_Leaf(BVH_Stats& stats, Stats_Totals& totals, const AABB& box, int n_primitives, int depth) {
+	stats.leaves++;
+	stats.primitives += n_primitives;
+	stats.leaf_histogram[n_primitives]++;
+	stats.max_depth = std::max(stats.max_depth, depth);
+	totals.leaf_depth_sum += depth;
+	stats.sah_cost += box.Surface_Area() / totals.root_area * n_primitives * SAH_INTERSECT_COST;
+}
+
+inline void Add_Interior(BVH_Stats& stats, Stats_Totals& totals, const AABB& box, const AABB& left, const AABB& right) {
+	stats.interior_nodes++;
+	stats.sah_cost += box.Surface_Area() / totals.root_area * SAH_TRAVERSAL_COST;
+
+	AABB overlap = Intersection(left, right);
+	if (box.Surface_Area() > 0) {
+		totals.overlap_sum += overlap.Surface_Area() / box.Surface_Area();
+	}
+
+	double covered = static_cast<double>(Volume(left)) + Volume(right) - Volume(overlap);
+	if (Volume(box) > 0) {
+		totals.empty_sum += std::max(0.0, 1.0 - covered / Volume(box));
+	}
+}
+
+inline void Finish(BVH_Stats& stats, const Stats_Totals& totals) {
+	stats.average_depth = stats.leaves > 0 ? static_cast<float>(totals.leaf_depth_sum) / stats.leaves : 0.F;
+	stats.overlap_ratio = stats.interior_nodes > 0 ? static_cast<float>(totals.overlap_sum / stats.interior_nodes) : 0.F;
+	stats.empty_space_ratio = stats.interior_nodes > 0 ? static_cast<float>(totals.empty_sum / stats.interior_nodes) : 0.F;
+}
+
+static void Walk_Node(const std::shared_ptr<Hittable>& n, int depth, BVH_Stats& stats, Stats_Totals& totals) {
+	AABB box;
+	n->Bounding_Box(box);
+	std::shared_ptr<Hittable> left = n->Left();
+	std::shared_ptr<Hittable> right = n->Right();
+
+	if (left == nullptr) {
+		Add_Leaf(stats, totals, box, 1, depth);
+		return;
+	}
+
+	//	make_shared keeps the use and weak counts next to each node
+	stats.bytes += sizeof(BVH_Node) + 2 * sizeof(long);
+	if (left == right) {
+		stats.duplicate_children++;
+		stats.interior_nodes++;
+		stats.sah_cost += box.Surface_Area() / totals.root_area * SAH_TRAVERSAL_COST;
+		Walk_Node(left, depth + 1, stats, totals);
+		return;
+	}
+	AABB box_left, box_right;
+	left->Bounding_Box(box_left);
+	right->Bounding_Box(box_right);
+	Add_Interior(stats, totals, box, box_left, box_right);
+	Walk_Node(left, depth + 1, stats, totals);
+	Walk_Node(right, depth + 1, stats, totals);
+}
+
+BVH_Stats Compute_BVH_Stats(const std::shared_ptr<Hittable>& root) {
+	BVH_Stats stats;
+	Stats_Totals totals;
+	AABB box;
+	root->Bounding_Box(box);
+	totals.root_area = box.Surface_Area();
+	if (totals.root_area > 0) {
+		Walk_Node(root, 0, stats, totals);
+	}
+	Finish(stats, totals);
+	return stats;
+}
+
+static AABB Linear_Box(const Linear_BVH_Node& node) {
+	return AABB(Point3f(node.bounds_min[0], node.bounds_min[1], node.bounds_min[2]),
+		Point3f(node.bounds_max[0], node.bounds_max[1], node.bounds_max[2]));
+}
+
+static void Walk_Linear(const Linear_BVH& tree, int index, int depth, BVH_Stats& stats, Stats_Totals& totals) {
+	const Linear_BVH_Node& node = tree.nodes[index];
+	if (node.n_primitives > 0) {
+		Add_Leaf(stats, totals, Linear_Box(node), node.n_primitives, depth);
+		return;
+	}
+	Add_Interior(stats, totals, Linear_Box(node), Linear_Box(tree.nodes[index + 1]), Linear_Box(tree.nodes[node.second_child_offset]));
+	Walk_Linear(tree, index + 1, depth + 1, stats, totals);
+	Walk_Linear(tree, node.second_child_offset, depth + 1, stats, totals);
+}
+
+BVH_Stats Compute_BVH_Stats(const Linear_BVH& tree) {
+	BVH_Stats stats;
+	Stats_Totals totals;
+	if (tree.nodes.empty()) {
+		return stats;
+	}
+	totals.root_area = Linear_Box(tree.nodes.front()).Surface_Area();
+	if (totals.root_area > 0) {
+		Walk_Linear(tree, 0, 0, stats, totals);
+	}
+	stats.bytes = tree.nodes.size() * sizeof(Linear_BVH_Node) + tree.primitives.size() * sizeof(std::shared_ptr<Hittable>);
+	Finish(stats, totals);
+	return stats;
+}
+
+std::string BVH_Stats_JSON(const BVH_Stats& stats) {
+	std::ostringstream json;
+	json << "{\n"
+		<< "\t\"sah_cost\": " << stats.sah_cost << ",\n"
+		<< "\t\"interior_nodes\": " << stats.interior_nodes << ",\n"
+		<< "\t\"leaves\": " << stats.leaves << ",\n"
+		<< "\t\"primitives\": " << stats.primitives << ",\n"
+		<< "\t\"max_depth\": " << stats.max_depth << ",\n"
+		<< "\t\"average_depth\": " << stats.average_depth << ",\n"
+		<< "\t\"leaf_histogram\": {";
+	bool first = true;
+	for (const auto& bucket : stats.leaf_histogram) {
+		json << (first ? "" : ", ") << "\"" << bucket.first << "\": " << bucket.second;
+		first = false;
+	}
+	json << "},\n"
+		<< "\t\"duplicate_children\": " << stats.duplicate_children << ",\n"
+		<< "\t\"overlap_ratio\": " << stats.overlap_ratio << ",\n"
+		<< "\t\"empty_space_ratio\": " << stats.empty_space_ratio << ",\n"
+		<< "\t\"bytes\": " << stats.bytes << "\n"
+		<< "}\n";
+	return json.str();
+}
+
+void Write_BVH_Stats(const BVH_Stats& stats, const std::string& filename) {
+	std::ofstream file(filename);
+	if (!file) {
+		std::cout << "Error file not found!\n";
+		return;
+	}
+	file << BVH_Stats_JSON(stats);
+}
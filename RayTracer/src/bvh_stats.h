@@ -0,0 +1,30 @@
+#pragma once
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <string>
+#include "hittable.h"
+#include "linear_bvh.h"
+
+//	Quality figures for a built tree, written out as JSON so changes to the builders can be
+//	compared run to run
+struct BVH_Stats {
+	float sah_cost = 0.F;
+	int interior_nodes = 0;
+	int leaves = 0;
+	int primitives = 0;
+	int max_depth = 0;
+	float average_depth = 0.F;			//	over leaves
+	std::map<int, int> leaf_histogram;	//	primitives in a leaf -> number of leaves
+	int duplicate_children = 0;			//	nodes whose left and right are the same object
+	float overlap_ratio = 0.F;			//	sibling overlap area over node area, averaged over interior nodes
+	float empty_space_ratio = 0.F;		//	node volume outside both children, averaged over interior nodes
+	size_t bytes = 0;					//	tree structure only, primitives are not counted
+};
+
+//	Walks a BVH_Node tree as built by Build_Tree
+BVH_Stats Compute_BVH_Stats(const std::shared_ptr<Hittable>& root);
+BVH_Stats Compute_BVH_Stats(const Linear_BVH& tree);
+
+std::string BVH_Stats_JSON(const BVH_Stats& stats);
+void Write_BVH_Stats(const BVH_Stats& stats, const std::string& filename);
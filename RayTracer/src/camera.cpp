@@ -25,6 +25,31 @@ Ray Camera::Get_Ray(double s, double t) const {
 	return {origin + offset, lower_left_corner + s * horizontal + t * vertical - origin - offset};
 }
 
+uint64_t Camera::Get_Packet(int x, int y, int width, int height, int image_width, int image_height, Ray_Packet& packet) const {
+	packet.count = width * height;
+	float s[PACKET_SIZE], t[PACKET_SIZE], lens_x[PACKET_SIZE], lens_y[PACKET_SIZE];
+	for (int lane = 0; lane < packet.count; lane++) {
+		s[lane] = static_cast<float>((x + lane % width + Random_Double()) / (image_width - 1));
+		t[lane] = static_cast<float>((y + lane / width + Random_Double()) / (image_height - 1));
+		const Vec3f rd = lens_radius * Vec3f().Random_In_Unit_Disk();
+		lens_x[lane] = rd.x;
+		lens_y[lane] = rd.y;
+	}
+	//	The rest is straight line arithmetic over the lanes, which the compiler vectorises
+	for (int a = 0; a < 3; a++) {
+		for (int lane = 0; lane < packet.count; lane++) {
+			const float offset = u[a] * lens_x[lane] + v[a] * lens_y[lane];
+			packet.origin[a][lane] = origin[a] + offset;
+			packet.dir[a][lane] = lower_left_corner[a] + s[lane] * horizontal[a] + t[lane] * vertical[a] - origin[a] - offset;
+			packet.inv_dir[a][lane] = 1.F / packet.dir[a][lane];
+		}
+	}
+	for (int lane = 0; lane < packet.count; lane++) {
+		packet.t_max[lane] = static_cast<float>(infinity);
+	}
+	return packet.count == PACKET_SIZE ? ~uint64_t(0) : (uint64_t(1) << packet.count) - 1;
+}
+
 void Camera::LookFrom(Point3f lookfrom) {
 	w = (lookfrom - look_at).normalize();
 	u = (up.crossProduct(w)).normalize();
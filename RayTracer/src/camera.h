@@ -1,5 +1,6 @@
 #pragma once
 #include "common.h"
+#include "packet.h"
 
 class Camera {
 public:
@@ -7,6 +8,9 @@ public:
 	Camera(Point3f lookfrom, Point3f lookat, Vec3f vup, double vfov, double aspect_ratio, double aperture, double focus_dist);
 
 	Ray Get_Ray(double s, double t) const;
+	//	Rays through a width x height tile of pixels from (x, y), jittered within each pixel as
+	//	Get_Ray is, lane i through pixel (x + i % width, y + i / width). Returns the lanes set.
+	uint64_t Get_Packet(int x, int y, int width, int height, int image_width, int image_height, Ray_Packet& packet) const;
 	void LookFrom(Point3f lookfrom);
 
 private:
@@ -1,4 +1,5 @@
 #pragma once
+#include <algorithm>
 #include <cmath>
 #include <limits>
 #include <memory>
@@ -12,3 +13,25 @@ const double pi = 3.1415926535897932385;
 inline double Degrees_To_Radians(double degrees) {
 	return degrees * pi / 180;
 }
+
+//	Bounces every path takes before Russian_Roulette may end it
+constexpr int ROULETTE_DEPTH = 3;
+
+inline float Luminance(const Colour& c) {
+	return 0.2126F * c.r + 0.7152F * c.g + 0.0722F * c.b;
+}
+
+//	Past ROULETTE_DEPTH a path survives with probability equal to its throughput's luminance,
+//	and survivors are scaled up by the same odds so the estimate stays unbiased. Returns false
+//	when the path should end.
+inline bool Russian_Roulette(Colour& throughput, int bounce) {
+	if (bounce < ROULETTE_DEPTH) {
+		return true;
+	}
+	const float survival = std::min(1.F, Luminance(throughput));
+	if (Random_Double() >= survival) {
+		return false;
+	}
+	throughput /= survival;
+	return true;
+}
@@ -0,0 +1,319 @@
+#include "dynamic_bvh.h"
+#include "bvh.h"
+#include "timer.h"
+#include <functional>
+#include <queue>
+
+Dynamic_BVH::Dynamic_BVH(const Hittable_List& list) {
+	Timer t("Dynamic BVH build time: ");
+	nodes.reserve(2 * list.objects.size());
+	for (const auto& object : list.objects) {
+		Insert(object);
+	}
+}
+
+int Dynamic_BVH::Allocate_Node() {
+	int index;
+	if (!free_nodes.empty()) {
+		index = free_nodes.back();
+		free_nodes.pop_back();
+	}
+	else {
+		index = static_cast<int>(nodes.size());
+		nodes.emplace_back();
+	}
+	Dynamic_BVH_Node& node = nodes[index];
+	node.parent = -1;
+	node.child[0] = node.child[1] = -1;
+	node.height = 0;
+	return index;
+}
+
+void Dynamic_BVH::Free_Node(int index) {
+	nodes[index].object.reset();
+	nodes[index].height = -1;
+	free_nodes.push_back(index);
+}
+
+//	Padded like every other tree's boxes, AABB::Hit rejects a flat box such as a Quad's
+static void Leaf_Box(const Hittable& object, AABB& box) {
+	object.Bounding_Box(box);
+	box = Surrounding_Box(box, box);
+}
+
+void Dynamic_BVH::Insert(std::shared_ptr<Hittable> object) {
+	//	An object listed twice is only stored once
+	if (leaves.count(object.get())) {
+		return;
+	}
+	int leaf = Allocate_Node();
+	Leaf_Box(*object, nodes[leaf].box);
+	nodes[leaf].object = object;
+	leaves[object.get()] = leaf;
+	Insert_Leaf(leaf);
+}
+
+bool Dynamic_BVH::Remove(const Hittable* object) {
+	auto it = leaves.find(object);
+	if (it == leaves.end()) {
+		return false;
+	}
+	Remove_Leaf(it->second);
+	Free_Node(it->second);
+	leaves.erase(it);
+	return true;
+}
+
+bool Dynamic_BVH::Update(const Hittable* object) {
+	auto it = leaves.find(object);
+	if (it == leaves.end()) {
+		return false;
+	}
+	int leaf = it->second;
+	Remove_Leaf(leaf);
+	Leaf_Box(*nodes[leaf].object, nodes[leaf].box);
+	Insert_Leaf(leaf);
+	return true;
+}
+
+int Dynamic_BVH::Find_Best_Sibling(const AABB& box) const {
+	//	Cost of a sibling is the area of the new parent plus the area every ancestor grows by,
+	//	which is inherited down the tree. A subtree is skipped once the inherited cost plus the
+	//	area of the new box alone can not beat the best sibling found so far.
+	const float area = box.Surface_Area();
+	int best = root;
+	float best_cost = Enclosing_Box(nodes[root].box, box).Surface_Area();
+
+	typedef std::pair<float, int> Candidate;
+	std::priority_queue<Candidate, std::vector<Candidate>, std::greater<Candidate>> queue;
+	queue.push(Candidate(0.F, root));
+
+	while (!queue.empty()) {
+		float inherited = queue.top().first;
+		const Dynamic_BVH_Node& node = nodes[queue.top().second];
+		int index = queue.top().second;
+		queue.pop();
+		if (inherited + area >= best_cost) {
+			continue;
+		}
+
+		float direct = Enclosing_Box(node.box, box).Surface_Area();
+		if (direct + inherited < best_cost) {
+			best_cost = direct + inherited;
+			best = index;
+		}
+		if (node.Leaf()) {
+			continue;
+		}
+		float child_inherited = inherited + direct - node.box.Surface_Area();
+		if (child_inherited + area < best_cost) {
+			queue.push(Candidate(child_inherited, node.child[0]));
+			queue.push(Candidate(child_inherited, node.child[1]));
+		}
+	}
+	return best;
+}
+
+void Dynamic_BVH::Insert_Leaf(int leaf) {
+	if (root == -1) {
+		root = leaf;
+		nodes[leaf].parent = -1;
+		return;
+	}
+
+	int sibling = Find_Best_Sibling(nodes[leaf].box);
+	int old_parent = nodes[sibling].parent;
+	int new_parent = Allocate_Node();
+
+	nodes[new_parent].parent = old_parent;
+	nodes[new_parent].child[0] = sibling;
+	nodes[new_parent].child[1] = leaf;
+	nodes[sibling].parent = new_parent;
+	nodes[leaf].parent = new_parent;
+
+	if (old_parent == -1) {
+		root = new_parent;
+	}
+	else {
+		Dynamic_BVH_Node& parent = nodes[old_parent];
+		parent.child[parent.child[0] == sibling ? 0 : 1] = new_parent;
+	}
+	Refit_Ancestors(new_parent);
+}
+
+void Dynamic_BVH::Remove_Leaf(int leaf) {
+	if (leaf == root) {
+		root = -1;
+		return;
+	}
+
+	int parent = nodes[leaf].parent;
+	int grand_parent = nodes[parent].parent;
+	int sibling = nodes[parent].child[nodes[parent].child[0] == leaf ? 1 : 0];
+	Free_Node(parent);
+
+	nodes[sibling].parent = grand_parent;
+	if (grand_parent == -1) {
+		root = sibling;
+		return;
+	}
+	Dynamic_BVH_Node& node = nodes[grand_parent];
+	node.child[node.child[0] == parent ? 0 : 1] = sibling;
+	Refit_Ancestors(grand_parent);
+}
+
+void Dynamic_BVH::Refit_Ancestors(int index) {
+	while (index != -1) {
+		Dynamic_BVH_Node& node = nodes[index];
+		const Dynamic_BVH_Node& left = nodes[node.child[0]];
+		const Dynamic_BVH_Node& right = nodes[node.child[1]];
+		node.box = Enclosing_Box(left.box, right.box);
+		node.height = 1 + std::max(left.height, right.height);
+		Rotate(index);
+		index = node.parent;
+	}
+}
+
+void Dynamic_BVH::Rotate(int index) {
+	Dynamic_BVH_Node& node = nodes[index];
+	if (node.height < 2) {
+		return;
+	}
+
+	//	Swapping a child with one of its sibling's children leaves this node's box as it is and
+	//	only changes the box of that sibling, so the best rotation is the one shrinking it most
+	int best_outer = -1;
+	int best_inner = -1;
+	float best_gain = 0.F;
+	for (int outer = 0; outer < 2; outer++) {
+		const Dynamic_BVH_Node& other = nodes[node.child[1 - outer]];
+		if (other.Leaf()) {
+			continue;
+		}
+		const AABB& outer_box = nodes[node.child[outer]].box;
+		float area = other.box.Surface_Area();
+		for (int inner = 0; inner < 2; inner++) {
+			float gain = area - Enclosing_Box(outer_box, nodes[other.child[1 - inner]].box).Surface_Area();
+			if (gain > best_gain) {
+				best_gain = gain;
+				best_outer = outer;
+				best_inner = inner;
+			}
+		}
+	}
+	if (best_outer == -1) {
+		return;
+	}
+
+	int outer = node.child[best_outer];
+	int other_index = node.child[1 - best_outer];
+	Dynamic_BVH_Node& other = nodes[other_index];
+	int inner = other.child[best_inner];
+
+	node.child[best_outer] = inner;
+	nodes[inner].parent = index;
+	other.child[best_inner] = outer;
+	nodes[outer].parent = other_index;
+
+	other.box = Enclosing_Box(nodes[other.child[0]].box, nodes[other.child[1]].box);
+	other.height = 1 + std::max(nodes[other.child[0]].height, nodes[other.child[1]].height);
+	node.height = 1 + std::max(nodes[node.child[0]].height, nodes[node.child[1]].height);
+}
+
+//	Every pop pushes at most two children, one of which is popped next, so the stack never
+//	holds more than the tree's height plus one
+int* Dynamic_BVH::Traversal_Stack(int* local_stack, std::vector<int>& deep_stack) const {
+	if (nodes[root].height < DYNAMIC_BVH_STACK_SIZE) {
+		return local_stack;
+	}
+	deep_stack.resize(nodes[root].height + 1);
+	return deep_stack.data();
+}
+
+bool Dynamic_BVH::Hit(const Ray& r, double t_min, double t_max, Hit_Record& rec) const {
+	if (root == -1) {
+		return false;
+	}
+	const Vec3f dir = r.Direction();
+	int local_stack[DYNAMIC_BVH_STACK_SIZE];
+	std::vector<int> deep_stack;
+	int* stack = Traversal_Stack(local_stack, deep_stack);
+	int top = 0;
+	stack[top++] = root;
+
+	bool hit_anything = false;
+	double closest = t_max;
+	while (top > 0) {
+		const Dynamic_BVH_Node& node = nodes[stack[--top]];
+		if (!node.box.Hit(r, t_min, closest)) {
+			continue;
+		}
+		if (node.Leaf()) {
+			if (node.object->Hit(r, t_min, closest, rec)) {
+				hit_anything = true;
+				closest = rec.t;
+			}
+			continue;
+		}
+		//	Visit the child whose centre comes first along the ray first
+		const Vec3f d = nodes[node.child[1]].box.Centroid() - nodes[node.child[0]].box.Centroid();
+		bool second_first = d.dotProduct(dir) < 0.F;
+		stack[top++] = node.child[second_first ? 0 : 1];
+		stack[top++] = node.child[second_first ? 1 : 0];
+	}
+	return hit_anything;
+}
+
+bool Dynamic_BVH::Occluded(const Ray& r, double t_min, double t_max) const {
+	if (root == -1) {
+		return false;
+	}
+	int local_stack[DYNAMIC_BVH_STACK_SIZE];
+	std::vector<int> deep_stack;
+	int* stack = Traversal_Stack(local_stack, deep_stack);
+	int top = 0;
+	stack[top++] = root;
+
+	while (top > 0) {
+		const Dynamic_BVH_Node& node = nodes[stack[--top]];
+		if (!node.box.Hit(r, t_min, t_max)) {
+			continue;
+		}
+		if (node.Leaf()) {
+			if (node.object->Occluded(r, t_min, t_max)) {
+				return true;
+			}
+			continue;
+		}
+		stack[top++] = node.child[0];
+		stack[top++] = node.child[1];
+	}
+	return false;
+}
+
+bool Dynamic_BVH::Bounding_Box(AABB& output_box) const {
+	if (root == -1) {
+		return false;
+	}
+	output_box = nodes[root].box;
+	return true;
+}
+
+float Dynamic_BVH::SAH_Cost() const {
+	if (root == -1) {
+		return 0.F;
+	}
+	float root_area = nodes[root].box.Surface_Area();
+	if (root_area <= 0) {
+		return 0.F;
+	}
+	float cost = 0.F;
+	for (const auto& node : nodes) {
+		if (node.height < 0) {
+			continue;
+		}
+		float area = node.box.Surface_Area() / root_area;
+		cost += node.Leaf() ? area * SAH_INTERSECT_COST : area * SAH_TRAVERSAL_COST;
+	}
+	return cost;
+}
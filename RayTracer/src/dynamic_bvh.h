@@ -0,0 +1,62 @@
+#pragma once
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include "hittable.h"
+#include "hittable_list.h"
+
+//	Leaves are single objects, interior nodes always have two children
+struct Dynamic_BVH_Node {
+	AABB box;
+	std::shared_ptr<Hittable> object;	//	null for interior and free nodes
+	int parent;
+	int child[2];
+	int height;							//	0 for leaves, -1 for free nodes
+
+	bool Leaf() const { return child[0] == -1; }
+};
+
+//	Rotations keep real trees far shallower, a taller one is walked with a heap allocated stack
+constexpr int DYNAMIC_BVH_STACK_SIZE = 256;
+
+//	Binary tree that objects can be inserted into and removed from one at a time, for editing
+//	a scene between frames. Nothing is locked, so rendering must be stopped while the tree is
+//	edited. Insertion picks the sibling with the smallest SAH cost increase using a branch and
+//	bound search, and every node refitted on the way back up is rotated when swapping a child
+//	with a grandchild shrinks it. Removal refits and rotates the same way.
+class Dynamic_BVH : public Hittable {
+public:
+	Dynamic_BVH() {}
+	Dynamic_BVH(const Hittable_List& list);
+
+	virtual bool Hit(const Ray& r, double t_min, double t_max, Hit_Record& rec) const override;
+	virtual bool Bounding_Box(AABB& output_box) const override;
+	virtual bool Occluded(const Ray& r, double t_min, double t_max) const override;
+
+	void Insert(std::shared_ptr<Hittable> object);
+	//	Returns false when the object is not in the tree
+	bool Remove(const Hittable* object);
+	//	Reinserts an object whose box has changed, for example after Translate
+	bool Update(const Hittable* object);
+
+	size_t Size() const { return leaves.size(); }
+	float SAH_Cost() const;
+
+public:
+	std::vector<Dynamic_BVH_Node> nodes;
+	int root = -1;
+
+private:
+	int Allocate_Node();
+	void Free_Node(int index);
+	int Find_Best_Sibling(const AABB& box) const;
+	void Insert_Leaf(int leaf);
+	void Remove_Leaf(int leaf);
+	//	Refits and rotates every node from index up to the root
+	void Refit_Ancestors(int index);
+	void Rotate(int index);
+	int* Traversal_Stack(int* local_stack, std::vector<int>& deep_stack) const;
+
+	std::vector<int> free_nodes;
+	std::unordered_map<const Hittable*, int> leaves;
+};
@@ -12,5 +12,43 @@ enum {
 	HITTABLE = 0,
 	BVH_NODE,		
 	TRIANGLE,		
-	SPHERE			
+	SPHERE,
+	INSTANCE,
+	PLANE,
+	QUAD
+};
+
+enum {
+	BINARY_BVH = 0,
+	LINEAR_BVH,
+	WIDE_BVH4,
+	WIDE_BVH8,
+	QUANTIZED_BVH4,
+	UNIFORM_GRID,
+	LAZY_BVH,
+	DYNAMIC_BVH
+};
+
+enum {
+	DEPTH_FIRST_ORDER = 0,
+	HOT_CHILD_ORDER,
+	TREELET_ORDER,
+	VAN_EMDE_BOAS_ORDER
+};
+
+enum {
+	NO_PROXY = 0,
+	SPHERE_PROXY,
+	QUAD_PROXY
+};
+
+enum {
+	SAH_BUILDER = 0,
+	MORTON_BUILDER,
+	SPATIAL_BUILDER
+};
+
+enum {
+	FLOAT_VERTICES = 0,
+	COMPRESSED_VERTICES
 };
@@ -1,6 +1,7 @@
 #pragma once
 #include "ray.h"
 #include "aabb.h"
+#include "packet.h"
 
 class Material;
 
@@ -23,6 +24,33 @@ public:
 	virtual bool Hit(const Ray& r, double t_min, double t_max, Hit_Record& rec) const = 0;
 	virtual bool Bounding_Box(AABB& output_box) const = 0;
 
+	//	Any hit in the range, for shadow and visibility rays. Stops at the first intersection
+	//	and skips the record, the default falls back to a closest hit.
+	virtual bool Occluded(const Ray& r, double t_min, double t_max) const {
+		Hit_Record rec;
+		return Hit(r, t_min, t_max, rec);
+	}
+
+	//	Closest hit of every lane in active, nearer than the lane's t_max which then shrinks to
+	//	it. Fills the records of the lanes hit and returns them. The default traces the lanes
+	//	one at a time, trees override it to share one traversal between them.
+	virtual uint64_t Hit_Packet(Ray_Packet& packet, uint64_t active, double t_min, Hit_Record* recs) const {
+		uint64_t hits = 0;
+		for (int lane = 0; lane < packet.count; lane++) {
+			if (Lane_Active(active, lane) && Hit(packet.Lane_Ray(lane), t_min, packet.t_max[lane], recs[lane])) {
+				packet.t_max[lane] = static_cast<float>(recs[lane].t);
+				hits |= uint64_t(1) << lane;
+			}
+		}
+		return hits;
+	}
+	//	Whether Hit_Packet shares work between the lanes, otherwise a packet only adds overhead
+	//	and callers that have the choice trace the rays one at a time
+	virtual bool Packet_Traversal() const { return false; }
+
+	//	Moves the primitive, any tree over it then needs a Refit
+	virtual void Translate(const Vec3f& offset) {};
+
 	virtual std::shared_ptr<Hittable> Left() const { return nullptr; };
 	virtual std::shared_ptr<Hittable> Right() const { return nullptr; };
 	virtual AABB Box() const { return AABB(); };
@@ -1,6 +1,95 @@
 #include "hittable_list.h"
+#include "tree.h"
+#include "enum.h"
+
+#include <algorithm>
+
+static bool Is_Bounded(const std::shared_ptr<Hittable>& object) {
+	AABB box;
+	return object->Bounding_Box(box);
+}
+
+void Hittable_List::Build(int builder, int layout) {
+	//	An infinite box would make the root, and every node above the object, cover the scene
+	Hittable_List bounded;
+	unbounded.clear();
+	for (const auto& object : objects) {
+		if (Is_Bounded(object)) {
+			bounded.objects.push_back(object);
+		}
+		else {
+			unbounded.push_back(object);
+		}
+	}
+	if (bounded.objects.empty() && layout != DYNAMIC_BVH) {
+		accelerator.reset();
+		dynamic.reset();
+		return;
+	}
+	accelerator = Build_Accelerator(unbounded.empty() ? *this : bounded, builder, layout);
+	dynamic = layout == DYNAMIC_BVH ? std::static_pointer_cast<Dynamic_BVH>(accelerator) : nullptr;
+}
+
+void Hittable_List::Add(std::shared_ptr<Hittable> object) {
+	objects.push_back(object);
+	if (dynamic) {
+		if (Is_Bounded(object)) {
+			dynamic->Insert(object);
+		}
+		else {
+			unbounded.push_back(object);
+		}
+	}
+	else {
+		accelerator.reset();
+	}
+}
+
+void Hittable_List::Remove(const std::shared_ptr<Hittable>& object) {
+	auto it = std::find(objects.begin(), objects.end(), object);
+	if (it == objects.end()) {
+		return;
+	}
+	objects.erase(it);
+	if (dynamic) {
+		auto unbounded_it = std::find(unbounded.begin(), unbounded.end(), object);
+		if (unbounded_it != unbounded.end()) {
+			unbounded.erase(unbounded_it);
+		}
+		//	Still listed means it was added twice and stays in the tree
+		else if (std::find(objects.begin(), objects.end(), object) == objects.end()) {
+			dynamic->Remove(object.get());
+		}
+	}
+	else {
+		accelerator.reset();
+	}
+}
+
+void Hittable_List::Update(const std::shared_ptr<Hittable>& object) {
+	if (dynamic) {
+		if (std::find(unbounded.begin(), unbounded.end(), object) != unbounded.end()) {
+			return;
+		}
+		dynamic->Update(object.get());
+	}
+	else {
+		accelerator.reset();
+	}
+}
 
 bool Hittable_List::Hit(const Ray& r, double t_min, double t_max, Hit_Record& rec) const {
+	if (accelerator) {
+		//	The unbounded objects go first, their hit shortens the walk through the tree
+		bool hit_anything = false;
+		for (const auto& object : unbounded) {
+			if (object->Hit(r, t_min, t_max, rec)) {
+				hit_anything = true;
+				t_max = rec.t;
+			}
+		}
+		return accelerator->Hit(r, t_min, t_max, rec) || hit_anything;
+	}
 	Hit_Record temp_rec;
 	bool hit_anything = false;
 	auto closest_so_far = t_max;
@@ -15,8 +104,54 @@ bool Hittable_List::Hit(const Ray& r, double t_min, double t_max, Hit_Record& re
 	return hit_anything;
 }
 
+uint64_t Hittable_List::Hit_Packet(Ray_Packet& packet, uint64_t active, double t_min, Hit_Record* recs) const {
+	uint64_t hits = 0;
+	if (accelerator) {
+		for (const auto& object : unbounded) {
+			hits |= object->Hit_Packet(packet, active, t_min, recs);
+		}
+		return hits | accelerator->Hit_Packet(packet, active, t_min, recs);
+	}
+	for (const auto& object : objects) {
+		hits |= object->Hit_Packet(packet, active, t_min, recs);
+	}
+	return hits;
+}
+
+bool Hittable_List::Packet_Traversal() const {
+	if (accelerator) {
+		return accelerator->Packet_Traversal();
+	}
+	for (const auto& object : objects) {
+		if (object->Packet_Traversal()) {
+			return true;
+		}
+	}
+	return false;
+}
+
+bool Hittable_List::Occluded(const Ray& r, double t_min, double t_max) const {
+	if (accelerator) {
+		for (const auto& object : unbounded) {
+			if (object->Occluded(r, t_min, t_max)) {
+				return true;
+			}
+		}
+		return accelerator->Occluded(r, t_min, t_max);
+	}
+	for (const auto& object : objects) {
+		if (object->Occluded(r, t_min, t_max)) {
+			return true;
+		}
+	}
+	return false;
+}
+
 bool Hittable_List::Bounding_Box(AABB& output_box) const
 {
+	if (accelerator && unbounded.empty()) {
+		return accelerator->Bounding_Box(output_box);
+	}
 	if (objects.empty()){
 		return false;
 	}
@@ -27,9 +162,10 @@ bool Hittable_List::Bounding_Box(AABB& output_box) const
 		if (!object->Bounding_Box(temp_box)){
 			return false;
 		}
-		output_box = first_box ? temp_box : Surrounding_Box(output_box, temp_box);
+		output_box = first_box ? temp_box : Enclosing_Box(output_box, temp_box);
 		first_box = false;
 	}
-
+	//	Padded once, padding every union grew the box with the object count
+	output_box = Surrounding_Box(output_box, output_box);
 	return true;
 }
\ No newline at end of file
@@ -3,17 +3,34 @@
 #include<memory>
 #include<vector>
 
+class Dynamic_BVH;
+
 class Hittable_List : public Hittable {
 public:
 	Hittable_List() {}
 	Hittable_List(std::shared_ptr<Hittable> object) { Add(object); }
 
-	void Clear() { objects.clear(); }
-	void Add(std::shared_ptr<Hittable> object) { objects.push_back(object); }
+	void Clear() { objects.clear(); unbounded.clear(); accelerator.reset(); dynamic.reset(); }
+	void Add(std::shared_ptr<Hittable> object);
+	void Remove(const std::shared_ptr<Hittable>& object);
+	//	Call after moving an object so a DYNAMIC_BVH can reinsert it
+	void Update(const std::shared_ptr<Hittable>& object);
+
+	//	Builds the chosen acceleration structure over the objects, Hit and Occluded then go
+	//	through it instead of testing every object. Adding or removing objects drops it again,
+	//	except for a DYNAMIC_BVH which is edited in place. Objects without a bounding box, like
+	//	planes, stay out of the tree and are tested ahead of it.
+	void Build(int builder, int layout);
 
 	virtual bool Hit(const Ray& r, double t_min, double t_max, Hit_Record& rec) const override;
 	virtual bool Bounding_Box(AABB& output_box) const override;
+	virtual bool Occluded(const Ray& r, double t_min, double t_max) const override;
+	virtual uint64_t Hit_Packet(Ray_Packet& packet, uint64_t active, double t_min, Hit_Record* recs) const override;
+	virtual bool Packet_Traversal() const override;
 
 public:
 	std::vector<std::shared_ptr<Hittable>> objects;
+	std::shared_ptr<Hittable> accelerator;
+	std::shared_ptr<Dynamic_BVH> dynamic;		//	the accelerator when it is a DYNAMIC_BVH
+	std::vector<std::shared_ptr<Hittable>> unbounded;	//	objects left out of the accelerator
 };
\ No newline at end of file
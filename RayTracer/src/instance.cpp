@@ -0,0 +1,117 @@
+#include "instance.h"
+
+Instance::Instance(std::shared_ptr<Hittable> obj, const Matrix44f& object_to_world, std::shared_ptr<Material> mat)
+	: object(obj), mat_ptr(mat)
+{
+	id = INSTANCE;
+	Transform(object_to_world);
+}
+
+bool Instance::Hit(const Ray& r, double t_min, double t_max, Hit_Record& rec) const
+{
+	//	The direction is left unnormalised so t means the same in both spaces
+	Point3f origin;
+	Vec3f direction;
+	inverse.multVecMatrix(r.Origin(), origin);
+	inverse.multDirMatrix(r.Direction(), direction);
+
+	if (!object->Hit(Ray(origin, direction), t_min, t_max, rec)) {
+		return false;
+	}
+
+	Vec3f normal;
+	normal_transform.multDirMatrix(rec.normal, normal);
+	rec.normal = normal.normalize();
+	rec.p = r.At(rec.t);
+	if (mat_ptr) {
+		rec.mat_ptr = mat_ptr;
+	}
+	return true;
+}
+
+uint64_t Instance::Hit_Packet(Ray_Packet& packet, uint64_t active, double t_min, Hit_Record* recs) const
+{
+	//	The lanes move to object space together so the object can still trace them as a packet
+	Ray_Packet local;
+	local.count = packet.count;
+	for (int lane = 0; lane < packet.count; lane++) {
+		if (!Lane_Active(active, lane)) {
+			continue;
+		}
+		Point3f origin;
+		Vec3f direction;
+		inverse.multVecMatrix(Point3f(packet.origin[0][lane], packet.origin[1][lane], packet.origin[2][lane]), origin);
+		inverse.multDirMatrix(Vec3f(packet.dir[0][lane], packet.dir[1][lane], packet.dir[2][lane]), direction);
+		local.Set_Lane(lane, origin, direction, packet.t_max[lane]);
+	}
+
+	const uint64_t hits = object->Hit_Packet(local, active, t_min, recs);
+	for (int lane = 0; lane < packet.count; lane++) {
+		if (!Lane_Active(hits, lane)) {
+			continue;
+		}
+		Hit_Record& rec = recs[lane];
+		Vec3f normal;
+		normal_transform.multDirMatrix(rec.normal, normal);
+		rec.normal = normal.normalize();
+		rec.p = packet.Lane_Ray(lane).At(rec.t);
+		if (mat_ptr) {
+			rec.mat_ptr = mat_ptr;
+		}
+		packet.t_max[lane] = local.t_max[lane];
+	}
+	return hits;
+}
+
+bool Instance::Occluded(const Ray& r, double t_min, double t_max) const
+{
+	Point3f origin;
+	Vec3f direction;
+	inverse.multVecMatrix(r.Origin(), origin);
+	inverse.multDirMatrix(r.Direction(), direction);
+	return object->Occluded(Ray(origin, direction), t_min, t_max);
+}
+
+bool Instance::Bounding_Box(AABB& output_box) const
+{
+	output_box = box;
+	return true;
+}
+
+void Instance::Translate(const Vec3f& offset)
+{
+	Matrix44f moved = transform;
+	moved[3][0] += offset.x;
+	moved[3][1] += offset.y;
+	moved[3][2] += offset.z;
+	Transform(moved);
+}
+
+void Instance::Transform(const Matrix44f& object_to_world)
+{
+	transform = object_to_world;
+	inverse = transform.inverse();
+	normal_transform = inverse.transposed();
+
+	//	World box around the eight transformed corners of the object box
+	AABB local;
+	object->Bounding_Box(local);
+	box = Empty_Box();
+	for (int i = 0; i < 8; i++) {
+		Point3f corner(i & 1 ? local.maximum.x : local.minimum.x,
+			i & 2 ? local.maximum.y : local.minimum.y,
+			i & 4 ? local.maximum.z : local.minimum.z);
+		Point3f moved;
+		transform.multVecMatrix(corner, moved);
+		box = Enclosing_Box(box, AABB(moved, moved));
+	}
+}
+
+Matrix44f Translation(const Vec3f& offset)
+{
+	Matrix44f m;
+	m[3][0] = offset.x;
+	m[3][1] = offset.y;
+	m[3][2] = offset.z;
+	return m;
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <memory>
+#include "hittable.h"
+#include "geometry.h"
+#include "enum.h"
+
+//	Places a shared object space tree in the world. Rays are moved into object space at the
+//	instance so one bottom level tree can be drawn any number of times.
+class Instance : public Hittable {
+public:
+	Instance(std::shared_ptr<Hittable> obj, const Matrix44f& object_to_world, std::shared_ptr<Material> mat = nullptr);
+
+	virtual bool Hit(const Ray& r, double t_min, double t_max, Hit_Record& rec) const override;
+	virtual bool Bounding_Box(AABB& output_box) const override;
+	virtual bool Occluded(const Ray& r, double t_min, double t_max) const override;
+	virtual uint64_t Hit_Packet(Ray_Packet& packet, uint64_t active, double t_min, Hit_Record* recs) const override;
+	virtual bool Packet_Traversal() const override { return object->Packet_Traversal(); }
+	virtual void Translate(const Vec3f& offset) override;
+
+	void Transform(const Matrix44f& object_to_world);
+
+public:
+	std::shared_ptr<Hittable> object;
+	Matrix44f transform;
+	Matrix44f inverse;
+	Matrix44f normal_transform;
+	std::shared_ptr<Material> mat_ptr;	//	Replaces the object's material when set
+	AABB box;
+};
+
+Matrix44f Translation(const Vec3f& offset);
@@ -0,0 +1,79 @@
+#include "lazy_bvh.h"
+#include "tree.h"
+#include "timer.h"
+
+Lazy_BVH_Node::Lazy_BVH_Node(std::vector<std::shared_ptr<Hittable>> objects, const AABB& box, int builder)
+	: objects(std::move(objects)), box(box), builder(builder) {
+}
+
+const Hittable& Lazy_BVH_Node::Subtree() const {
+	std::call_once(built, [this]() {
+		std::shared_ptr<Hittable> root;
+		if (builder == SAH_BUILDER) {
+			//	Untimed constructor, the other builders report their own time
+			root = std::make_shared<BVH_Node>(objects, 0, objects.size());
+		}
+		else {
+			Hittable_List list;
+			list.objects = objects;
+			root = Build_Tree(list, builder);
+		}
+		subtree = Flatten_Tree(root, LINEAR_BVH);
+		objects.clear();
+		objects.shrink_to_fit();
+	});
+	return *subtree;
+}
+
+bool Lazy_BVH_Node::Hit(const Ray& r, double t_min, double t_max, Hit_Record& rec) const {
+	//	Tested here as well as by the parent, a leaf of the top tree may hold several of these
+	//	and only the ones a ray actually enters should be built
+	if (!box.Hit(r, t_min, t_max)) {
+		return false;
+	}
+	return Subtree().Hit(r, t_min, t_max, rec);
+}
+
+bool Lazy_BVH_Node::Occluded(const Ray& r, double t_min, double t_max) const {
+	if (!box.Hit(r, t_min, t_max)) {
+		return false;
+	}
+	return Subtree().Occluded(r, t_min, t_max);
+}
+
+bool Lazy_BVH_Node::Bounding_Box(AABB& output_box) const {
+	output_box = box;
+	return true;
+}
+
+static std::shared_ptr<Hittable> Build_Top(const std::vector<std::shared_ptr<Hittable>>& objects, std::vector<BVH_Primitive>& prims,
+	size_t start, size_t end, int builder, size_t subtree_size) {
+	AABB box = Empty_Box();
+	for (size_t i = start; i < end; i++) {
+		box = Enclosing_Box(box, prims[i].box);
+	}
+	box = Surrounding_Box(box, box);
+
+	if (end - start <= subtree_size) {
+		std::vector<std::shared_ptr<Hittable>> subset;
+		subset.reserve(end - start);
+		for (size_t i = start; i < end; i++) {
+			subset.push_back(objects[prims[i].index]);
+		}
+		return std::make_shared<Lazy_BVH_Node>(std::move(subset), box, builder);
+	}
+
+	int axis;
+	size_t mid = Partition_SAH(prims, start, end, axis);
+
+	auto node = std::make_shared<BVH_Node>(box);
+	node->left = Build_Top(objects, prims, start, mid, builder, subtree_size);
+	node->right = Build_Top(objects, prims, mid, end, builder, subtree_size);
+	return node;
+}
+
+std::shared_ptr<Hittable> Build_Lazy_BVH(const Hittable_List& list, int builder, size_t subtree_size) {
+	Timer t("Lazy BVH top build time: ");
+	std::vector<BVH_Primitive> prims = Gather_Primitives(list.objects, 0, list.objects.size());
+	return Build_Top(list.objects, prims, 0, prims.size(), builder, std::max<size_t>(subtree_size, 1));
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "hittable.h"
+#include "hittable_list.h"
+
+//	Subtrees of at most this many objects are left unbuilt until a ray reaches them
+constexpr size_t LAZY_SUBTREE_SIZE = 4096;
+
+//	Stand-in for a subtree that is only built the first time a ray enters its box. The build
+//	runs once under std::call_once, so any number of render threads can hit it concurrently.
+class Lazy_BVH_Node : public Hittable {
+public:
+	Lazy_BVH_Node(std::vector<std::shared_ptr<Hittable>> objects, const AABB& box, int builder);
+
+	virtual bool Hit(const Ray& r, double t_min, double t_max, Hit_Record& rec) const override;
+	virtual bool Bounding_Box(AABB& output_box) const override;
+	virtual bool Occluded(const Ray& r, double t_min, double t_max) const override;
+
+private:
+	const Hittable& Subtree() const;
+
+	//	Released once the subtree owns them
+	mutable std::vector<std::shared_ptr<Hittable>> objects;
+	mutable std::shared_ptr<Hittable> subtree;
+	mutable std::once_flag built;
+	AABB box;
+	int builder;
+};
+
+//	Builds the top levels of a SAH tree right away and puts a Lazy_BVH_Node below them
+//	wherever a range shrinks to subtree_size objects
+std::shared_ptr<Hittable> Build_Lazy_BVH(const Hittable_List& list, int builder, size_t subtree_size = LAZY_SUBTREE_SIZE);
@@ -0,0 +1,196 @@
+#include "lbvh.h"
+#include "threadpool.h"
+#include "timer.h"
+
+constexpr int MORTON_BITS = 21;
+constexpr int RADIX_BITS = 8;
+constexpr int RADIX_BUCKETS = 1 << RADIX_BITS;
+
+inline uint64_t Expand_Bits(uint64_t v) {
+	v &= 0x1fffff;
+	v = (v | v << 32) & 0x1f00000000ffffULL;
+	v = (v | v << 16) & 0x1f0000ff0000ffULL;
+	v = (v | v << 8) & 0x100f00f00f00f00fULL;
+	v = (v | v << 4) & 0x10c30c30c30c30c3ULL;
+	v = (v | v << 2) & 0x1249249249249249ULL;
+	return v;
+}
+
+inline int Leading_Zeros(uint64_t x) {
+#if defined(__GNUC__)
+	return x == 0 ? 64 : __builtin_clzll(x);
+#else
+	int n = 0;
+	for (uint64_t bit = 1ULL << 63; bit != 0 && !(x & bit); bit >>= 1) {
+		n++;
+	}
+	return n;
+#endif
+}
+
+//	p is expected in [0, 1] on every axis
+uint64_t Morton_Code(const Point3f& p) {
+	const float scale = static_cast<float>((1 << MORTON_BITS) - 1);
+	uint64_t x = static_cast<uint64_t>(std::min(std::max(p.x * scale, 0.F), scale));
+	uint64_t y = static_cast<uint64_t>(std::min(std::max(p.y * scale, 0.F), scale));
+	uint64_t z = static_cast<uint64_t>(std::min(std::max(p.z * scale, 0.F), scale));
+	return (Expand_Bits(x) << 2) | (Expand_Bits(y) << 1) | Expand_Bits(z);
+}
+
+//	Parallel LSD radix sort, 8 bits a pass. Passes where every key shares the same digit are skipped.
+void Radix_Sort(std::vector<uint64_t>& keys, std::vector<uint32_t>& values) {
+	const size_t n = keys.size();
+	const size_t chunks = Parallel_Chunks(n);
+	std::vector<uint64_t> keys_tmp(n);
+	std::vector<uint32_t> values_tmp(n);
+	std::vector<size_t> histogram(chunks * RADIX_BUCKETS);
+
+	for (int shift = 0; shift < 64; shift += RADIX_BITS) {
+		std::fill(begin(histogram), end(histogram), 0);
+		Parallel_For(n, [&](size_t first, size_t last, size_t chunk) {
+			size_t* counts = &histogram[chunk * RADIX_BUCKETS];
+			for (size_t i = first; i < last; i++) {
+				counts[(keys[i] >> shift) & (RADIX_BUCKETS - 1)]++;
+			}
+		});
+
+		//	Bucket major, chunk minor prefix sum keeps the sort stable
+		size_t sum = 0;
+		bool single_bucket = false;
+		for (int b = 0; b < RADIX_BUCKETS; b++) {
+			size_t bucket_total = 0;
+			for (size_t c = 0; c < chunks; c++) {
+				size_t count = histogram[c * RADIX_BUCKETS + b];
+				histogram[c * RADIX_BUCKETS + b] = sum;
+				sum += count;
+				bucket_total += count;
+			}
+			single_bucket |= bucket_total == n;
+		}
+		if (single_bucket) {
+			continue;
+		}
+
+		Parallel_For(n, [&](size_t first, size_t last, size_t chunk) {
+			size_t* offsets = &histogram[chunk * RADIX_BUCKETS];
+			for (size_t i = first; i < last; i++) {
+				size_t dst = offsets[(keys[i] >> shift) & (RADIX_BUCKETS - 1)]++;
+				keys_tmp[dst] = keys[i];
+				values_tmp[dst] = values[i];
+			}
+		});
+		keys.swap(keys_tmp);
+		values.swap(values_tmp);
+	}
+}
+
+//	Karras 2012, "Maximizing Parallelism in the Construction of BVHs, Octrees, and k-d Trees".
+//	Internal node i covers a range of sorted primitives that starts or ends at i, so every
+//	node is found independently. Children < n - 1 are internal nodes, the rest leaf n - 1 + index.
+struct LBVH_Builder {
+	const std::vector<uint64_t>& codes;
+	int n;
+
+	int Delta(int i, int j) const {
+		if (j < 0 || j >= n) {
+			return -1;
+		}
+		if (codes[i] == codes[j]) {
+			return 64 + Leading_Zeros(static_cast<uint64_t>(i ^ j));
+		}
+		return Leading_Zeros(codes[i] ^ codes[j]);
+	}
+
+	void Internal_Node(int i, int& left, int& right) const {
+		int d = (Delta(i, i + 1) - Delta(i, i - 1)) >= 0 ? 1 : -1;
+		int delta_min = Delta(i, i - d);
+
+		int l_max = 2;
+		while (Delta(i, i + l_max * d) > delta_min) {
+			l_max *= 2;
+		}
+		int l = 0;
+		for (int t = l_max / 2; t >= 1; t /= 2) {
+			if (Delta(i, i + (l + t) * d) > delta_min) {
+				l += t;
+			}
+		}
+		int j = i + l * d;
+
+		int delta_node = Delta(i, j);
+		int s = 0;
+		for (int divisor = 2, t = (l + 1) / 2; ; divisor *= 2, t = (l + divisor - 1) / divisor) {
+			if (Delta(i, i + (s + t) * d) > delta_node) {
+				s += t;
+			}
+			if (t == 1) {
+				break;
+			}
+		}
+		int gamma = i + s * d + std::min(d, 0);
+
+		left = std::min(i, j) == gamma ? (n - 1) + gamma : gamma;
+		right = std::max(i, j) == gamma + 1 ? (n - 1) + gamma + 1 : gamma + 1;
+	}
+};
+
+static std::shared_ptr<Hittable> Emit_Node(int node, const std::vector<int>& children, const std::vector<uint32_t>& order,
+	const std::vector<std::shared_ptr<Hittable>>& objects, int n) {
+	if (node >= n - 1) {
+		return objects[order[node - (n - 1)]];
+	}
+	auto bvh = std::make_shared<BVH_Node>();
+	bvh->left = Emit_Node(children[2 * node], children, order, objects, n);
+	bvh->right = Emit_Node(children[2 * node + 1], children, order, objects, n);
+
+	AABB box_left, box_right;
+	bvh->left->Bounding_Box(box_left);
+	bvh->right->Bounding_Box(box_right);
+	bvh->box = Surrounding_Box(box_left, box_right);
+	return bvh;
+}
+
+std::shared_ptr<Hittable> Build_LBVH(const Hittable_List& list) {
+	Timer t("LBVH build time: ");
+	const std::vector<std::shared_ptr<Hittable>>& objects = list.objects;
+	const int n = static_cast<int>(objects.size());
+	if (n == 1) {
+		return std::make_shared<BVH_Node>(objects, 0, 1);
+	}
+
+	std::vector<BVH_Primitive> prims(n);
+	Parallel_For(n, [&](size_t first, size_t last, size_t) {
+		for (size_t i = first; i < last; i++) {
+			objects[i]->Bounding_Box(prims[i].box);
+			prims[i].centroid = prims[i].box.Centroid();
+			prims[i].index = i;
+		}
+	});
+
+	AABB centroid_bounds = Empty_Box();
+	for (const auto& prim : prims) {
+		centroid_bounds = Enclosing_Box(centroid_bounds, AABB(prim.centroid, prim.centroid));
+	}
+	Vec3f extent = centroid_bounds.Max() - centroid_bounds.Min();
+	Vec3f inv_extent(extent.x > 0 ? 1 / extent.x : 0, extent.y > 0 ? 1 / extent.y : 0, extent.z > 0 ? 1 / extent.z : 0);
+
+	std::vector<uint64_t> codes(n);
+	std::vector<uint32_t> order(n);
+	Parallel_For(n, [&](size_t first, size_t last, size_t) {
+		for (size_t i = first; i < last; i++) {
+			codes[i] = Morton_Code((prims[i].centroid - centroid_bounds.Min()) * inv_extent);
+			order[i] = static_cast<uint32_t>(i);
+		}
+	});
+	Radix_Sort(codes, order);
+
+	LBVH_Builder builder = { codes, n };
+	std::vector<int> children(2 * (n - 1));
+	Parallel_For(n - 1, [&](size_t first, size_t last, size_t) {
+		for (size_t i = first; i < last; i++) {
+			builder.Internal_Node(static_cast<int>(i), children[2 * i], children[2 * i + 1]);
+		}
+	});
+
+	return Emit_Node(0, children, order, objects, n);
+}
\ No newline at end of file
@@ -0,0 +1,14 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "bvh.h"
+#include "hittable_list.h"
+
+//	Linear BVH: primitives are sorted along a 63 bit Morton curve of their centroids and the
+//	hierarchy is read straight off the sorted codes. Much faster to build than the SAH
+//	builder at the cost of some tree quality.
+std::shared_ptr<Hittable> Build_LBVH(const Hittable_List& list);
+
+uint64_t Morton_Code(const Point3f& p);
+void Radix_Sort(std::vector<uint64_t>& keys, std::vector<uint32_t>& values);
\ No newline at end of file
@@ -0,0 +1,332 @@
+#include "linear_bvh.h"
+#include "bvh.h"
+#include "Triangle.h"
+#include "enum.h"
+#include <future>
+
+Linear_BVH::Linear_BVH(std::shared_ptr<Hittable> root, int max_leaf_size) : max_leaf_size(max_leaf_size) {
+	Build(root);
+}
+
+void Linear_BVH::Build(const std::shared_ptr<Hittable>& root) {
+	nodes.clear();
+	primitives.clear();
+	nodes.reserve(1024);
+	float cost;
+	Flatten(Limit_Height(root, BVH_STACK_SIZE), cost);
+
+	triangles.clear();
+	for (const auto& p : primitives) {
+		triangles.push_back(p->id == TRIANGLE ? static_cast<const Triangle*>(p.get()) : nullptr);
+	}
+	build_cost = SAH_Cost();
+}
+
+//	cost is the SAH cost of the emitted subtree, not yet divided by the root area
+int Linear_BVH::Flatten(const std::shared_ptr<Hittable>& n, float& cost) {
+	AABB box;
+	n->Bounding_Box(box);
+
+	int offset = static_cast<int>(nodes.size());
+	nodes.emplace_back();
+	Linear_BVH_Node node = {};
+	Set_Node_Box(node, box);
+
+	std::shared_ptr<Hittable> left = n->Left();
+	std::shared_ptr<Hittable> right = n->Right();
+
+	if (left == nullptr || left == right) {
+		node.primitives_offset = static_cast<int>(primitives.size());
+		node.n_primitives = 1;
+		primitives.push_back(left == nullptr ? n : left);
+		cost = box.Surface_Area() * SAH_INTERSECT_COST;
+	}
+	else {
+		//	Split axis is the one separating the two child boxes the most
+		AABB box_left, box_right;
+		left->Bounding_Box(box_left);
+		right->Bounding_Box(box_right);
+		Vec3f d = box_right.Centroid() - box_left.Centroid();
+		d = Vec3f(std::fabs(d.x), std::fabs(d.y), std::fabs(d.z));
+		node.axis = (d.x > d.y && d.x > d.z) ? 0 : (d.y > d.z ? 1 : 2);
+
+		//	Keep the child with the smaller centroid on the axis first
+		if (box_right.Centroid()[node.axis] < box_left.Centroid()[node.axis]) {
+			std::swap(left, right);
+		}
+		size_t first_primitive = primitives.size();
+		float cost_left, cost_right;
+		Flatten(left, cost_left);
+		node.second_child_offset = Flatten(right, cost_right);
+		cost = box.Surface_Area() * SAH_TRAVERSAL_COST + cost_left + cost_right;
+
+		//	Both children sit contiguously after this node, as do their primitives, so turning
+		//	the subtree into one leaf only means dropping the nodes below it
+		size_t count = primitives.size() - first_primitive;
+		float leaf_cost = box.Surface_Area() * count * SAH_INTERSECT_COST;
+		if (count <= static_cast<size_t>(max_leaf_size) && leaf_cost <= cost) {
+			nodes.resize(offset + 1);
+			node.primitives_offset = static_cast<int>(first_primitive);
+			node.n_primitives = static_cast<uint16_t>(count);
+			node.axis = 0;
+			cost = leaf_cost;
+		}
+	}
+	nodes[offset] = node;
+	return offset;
+}
+
+bool Linear_BVH::Hit(const Ray& r, double t_min, double t_max, Hit_Record& rec) const {
+	const Point3f origin = r.Origin();
+	const Vec3f dir = r.Direction();
+	const Vec3f inv_dir(1.F / dir.x, 1.F / dir.y, 1.F / dir.z);
+	const bool dir_is_neg[3] = { inv_dir.x < 0, inv_dir.y < 0, inv_dir.z < 0 };
+
+	int to_visit[BVH_STACK_SIZE];
+	int to_visit_offset = 0;
+	int current = 0;
+	bool hit_anything = false;
+	double closest_so_far = t_max;
+
+	//	Triangles are tested inline and only the closest one writes the record, at the end
+	const Triangle* closest_triangle = nullptr;
+	float hit_u = 0.F, hit_v = 0.F;
+
+	while (true) {
+		const Linear_BVH_Node& node = nodes[current];
+		if (Box_Hit(node, origin, inv_dir, t_min, closest_so_far)) {
+			if (node.n_primitives > 0) {
+				const int end = node.primitives_offset + node.n_primitives;
+				for (int i = node.primitives_offset; i < end; i++) {
+					if (const Triangle* tri = triangles[i]) {
+						float t, u, v;
+						if (tri->Intersect(r, static_cast<float>(t_min), static_cast<float>(closest_so_far), t, u, v)) {
+							hit_anything = true;
+							closest_so_far = t;
+							closest_triangle = tri;
+							hit_u = u;
+							hit_v = v;
+						}
+					}
+					else if (primitives[i]->Hit(r, t_min, closest_so_far, rec)) {
+						hit_anything = true;
+						closest_so_far = rec.t;
+						closest_triangle = nullptr;
+					}
+				}
+				if (to_visit_offset == 0) {
+					break;
+				}
+				current = to_visit[--to_visit_offset];
+			}
+			else if (dir_is_neg[node.axis]) {
+				to_visit[to_visit_offset++] = current + 1;
+				current = node.second_child_offset;
+			}
+			else {
+				to_visit[to_visit_offset++] = node.second_child_offset;
+				current = current + 1;
+			}
+		}
+		else {
+			if (to_visit_offset == 0) {
+				break;
+			}
+			current = to_visit[--to_visit_offset];
+		}
+	}
+	if (closest_triangle) {
+		closest_triangle->Fill_Record(r, static_cast<float>(closest_so_far), hit_u, hit_v, rec);
+	}
+	return hit_anything;
+}
+
+bool Linear_BVH::Occluded(const Ray& r, double t_min, double t_max) const {
+	const Point3f origin = r.Origin();
+	const Vec3f dir = r.Direction();
+	const Vec3f inv_dir(1.F / dir.x, 1.F / dir.y, 1.F / dir.z);
+	const bool dir_is_neg[3] = { inv_dir.x < 0, inv_dir.y < 0, inv_dir.z < 0 };
+
+	int to_visit[BVH_STACK_SIZE];
+	int to_visit_offset = 0;
+	int current = 0;
+
+	while (true) {
+		const Linear_BVH_Node& node = nodes[current];
+		if (Box_Hit(node, origin, inv_dir, t_min, t_max)) {
+			if (node.n_primitives > 0) {
+				const int end = node.primitives_offset + node.n_primitives;
+				for (int i = node.primitives_offset; i < end; i++) {
+					float t, u, v;
+					if (triangles[i] ? triangles[i]->Intersect(r, static_cast<float>(t_min), static_cast<float>(t_max), t, u, v)
+						: primitives[i]->Occluded(r, t_min, t_max)) {
+						return true;
+					}
+				}
+				if (to_visit_offset == 0) {
+					break;
+				}
+				current = to_visit[--to_visit_offset];
+			}
+			else if (dir_is_neg[node.axis]) {
+				to_visit[to_visit_offset++] = current + 1;
+				current = node.second_child_offset;
+			}
+			else {
+				to_visit[to_visit_offset++] = node.second_child_offset;
+				current = current + 1;
+			}
+		}
+		else {
+			if (to_visit_offset == 0) {
+				break;
+			}
+			current = to_visit[--to_visit_offset];
+		}
+	}
+	return false;
+}
+
+uint64_t Linear_BVH::Hit_Packet(Ray_Packet& packet, uint64_t active, double t_min, Hit_Record* recs) const {
+	//	As in Hit the triangle records are only filled once the closest one is known
+	const Triangle* closest_triangle[PACKET_SIZE] = {};
+	float hit_u[PACKET_SIZE], hit_v[PACKET_SIZE];
+	uint64_t hits = 0;
+
+	Traverse_Packet(nodes, packet, active, static_cast<float>(t_min), [&](const Linear_BVH_Node& node, uint64_t lanes) {
+		uint64_t leaf_hits = 0;
+		const int end = node.primitives_offset + node.n_primitives;
+		for (int i = node.primitives_offset; i < end; i++) {
+			if (const Triangle* tri = triangles[i]) {
+				for (int lane = 0; lane < packet.count; lane++) {
+					float t, u, v;
+					if (Lane_Active(lanes, lane) && tri->Intersect(packet.Lane_Ray(lane), static_cast<float>(t_min), packet.t_max[lane], t, u, v)) {
+						packet.t_max[lane] = t;
+						closest_triangle[lane] = tri;
+						hit_u[lane] = u;
+						hit_v[lane] = v;
+						leaf_hits |= uint64_t(1) << lane;
+					}
+				}
+			}
+			else {
+				const uint64_t primitive_hits = primitives[i]->Hit_Packet(packet, lanes, t_min, recs);
+				for (int lane = 0; lane < packet.count; lane++) {
+					if (Lane_Active(primitive_hits, lane)) {
+						closest_triangle[lane] = nullptr;
+					}
+				}
+				leaf_hits |= primitive_hits;
+			}
+		}
+		hits |= leaf_hits;
+		return leaf_hits != 0;
+	});
+
+	for (int lane = 0; lane < packet.count; lane++) {
+		if (Lane_Active(hits, lane) && closest_triangle[lane]) {
+			closest_triangle[lane]->Fill_Record(packet.Lane_Ray(lane), packet.t_max[lane], hit_u[lane], hit_v[lane], recs[lane]);
+		}
+	}
+	return hits;
+}
+
+bool Linear_BVH::Bounding_Box(AABB& output_box) const {
+	if (nodes.empty()) {
+		return false;
+	}
+	output_box = Node_Box(nodes.front());
+	return true;
+}
+
+float Linear_BVH::SAH_Cost() const {
+	float root_area = Node_Box(nodes.front()).Surface_Area();
+	if (root_area <= 0) {
+		return 0.F;
+	}
+	float cost = 0.F;
+	for (const auto& node : nodes) {
+		float area = Node_Box(node).Surface_Area() / root_area;
+		cost += node.n_primitives > 0 ? area * node.n_primitives * SAH_INTERSECT_COST : area * SAH_TRAVERSAL_COST;
+	}
+	return cost;
+}
+
+AABB Linear_BVH::Refit_Node(int index, int parallel_depth) {
+	Linear_BVH_Node& node = nodes[index];
+	AABB box;
+
+	if (node.n_primitives > 0) {
+		box = Empty_Box();
+		for (int i = 0; i < node.n_primitives; i++) {
+			AABB prim_box;
+			primitives[node.primitives_offset + i]->Bounding_Box(prim_box);
+			box = Enclosing_Box(box, prim_box);
+		}
+	}
+	else if (parallel_depth > 0) {
+		auto first = std::async(std::launch::async, &Linear_BVH::Refit_Node, this, index + 1, parallel_depth - 1);
+		AABB box_second = Refit_Node(node.second_child_offset, parallel_depth - 1);
+		box = Surrounding_Box(first.get(), box_second);
+	}
+	else {
+		box = Surrounding_Box(Refit_Node(index + 1, 0), Refit_Node(node.second_child_offset, 0));
+	}
+	Set_Node_Box(node, box);
+	return box;
+}
+
+bool Linear_BVH::Refit(float rebuild_threshold) {
+	Refit_Node(0, Parallel_Build_Depth());
+
+	if (rebuild_threshold <= 0 || SAH_Cost() <= rebuild_threshold * build_cost) {
+		return false;
+	}
+	std::shared_ptr<Hittable> root = std::make_shared<BVH_Node>(Unique_Objects(primitives));
+	Build(root);
+	return true;
+}
+
+int Build_Block_Tree(std::vector<Linear_BVH_Node>& nodes, std::vector<BVH_Primitive>& prims, size_t start, size_t end, int max_leaf_size, int block_width, int depth) {
+	int offset = static_cast<int>(nodes.size());
+	nodes.emplace_back();
+	Linear_BVH_Node node = {};
+
+	AABB box = Empty_Box();
+	for (size_t i = start; i < end; i++) {
+		box = Enclosing_Box(box, prims[i].box);
+	}
+	Set_Node_Box(node, box);
+
+	//	Once a balanced tree would only just fit in the traversal stack, split at the median.
+	//	Otherwise stop splitting once a leaf is no dearer than the best split below it.
+	const size_t count = end - start;
+	const bool balance = Balanced_Height(count, max_leaf_size) >= BVH_STACK_SIZE - depth - 1;
+	bool leaf = count == 1 || (balance && count <= static_cast<size_t>(max_leaf_size));
+	SAH_Split split;
+	if (balance && !leaf) {
+		split = Find_SAH_Split(prims, start, end);
+		split.bin = -1;
+	}
+	else if (!leaf) {
+		split = Find_SAH_Split(prims, start, end);
+		//	A leaf costs one test per block, not per primitive, so the children are costed as if
+		//	their primitives filled whole blocks
+		float leaf_cost = ((count + block_width - 1) / block_width) * BVH_BLOCK_INTERSECT_COST * box.Surface_Area();
+		float split_cost = SAH_TRAVERSAL_COST * box.Surface_Area() + split.cost / block_width * BVH_BLOCK_INTERSECT_COST;
+		leaf = count <= static_cast<size_t>(max_leaf_size) && (split.bin == -1 || leaf_cost <= split_cost);
+	}
+
+	if (leaf) {
+		node.primitives_offset = static_cast<int>(start);
+		node.n_primitives = static_cast<uint16_t>(count);
+	}
+	else {
+		size_t mid = Partition_SAH(prims, start, end, split);
+		node.axis = static_cast<uint8_t>(split.axis);
+		Build_Block_Tree(nodes, prims, start, mid, max_leaf_size, block_width, depth + 1);
+		node.second_child_offset = Build_Block_Tree(nodes, prims, mid, end, max_leaf_size, block_width, depth + 1);
+	}
+	nodes[offset] = node;
+	return offset;
+}
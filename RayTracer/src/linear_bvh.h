@@ -0,0 +1,248 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "hittable.h"
+#include "simd.h"
+
+//	32 byte node packed depth first, the first child always follows its parent
+struct Linear_BVH_Node {
+	float bounds_min[3];
+	float bounds_max[3];
+	union {
+		int primitives_offset;		//	leaf
+		int second_child_offset;	//	interior
+	};
+	uint16_t n_primitives;			//	0 for interior nodes
+	uint8_t axis;
+	uint8_t pad;
+};
+
+static_assert(sizeof(Linear_BVH_Node) == 32, "Linear_BVH_Node should fill half a cache line");
+
+inline bool Box_Hit(const Linear_BVH_Node& node, const Point3f& origin, const Vec3f& inv_dir, float t_min, float t_max) {
+	for (int a = 0; a < 3; a++) {
+		float t0 = (node.bounds_min[a] - origin[a]) * inv_dir[a];
+		float t1 = (node.bounds_max[a] - origin[a]) * inv_dir[a];
+		if (inv_dir[a] < 0.F) {
+			std::swap(t0, t1);
+		}
+		t_min = t0 > t_min ? t0 : t_min;
+		t_max = t1 < t_max ? t1 : t_max;
+		if (t_max < t_min) {
+			return false;
+		}
+	}
+	return true;
+}
+
+inline AABB Node_Box(const Linear_BVH_Node& node) {
+	return AABB(Point3f(node.bounds_min[0], node.bounds_min[1], node.bounds_min[2]),
+		Point3f(node.bounds_max[0], node.bounds_max[1], node.bounds_max[2]));
+}
+
+inline void Set_Node_Box(Linear_BVH_Node& node, const AABB& box) {
+	for (int a = 0; a < 3; a++) {
+		node.bounds_min[a] = box.Min()[a];
+		node.bounds_max[a] = box.Max()[a];
+	}
+}
+
+//	Traversal stack depth. Trees are kept within it by Limit_Height and Build_Block_Tree.
+constexpr int BVH_STACK_SIZE = 64;
+
+//	Conservative test of the whole packet against a node: false only when no active lane can
+//	hit the box, from interval bounds of the lane origins and inverse directions
+inline bool Packet_Interval_Hit(const Linear_BVH_Node& node, const Packet_Bounds& bounds, float t_min) {
+	float enter = t_min;
+	float exit = bounds.far_t;
+	for (int a = 0; a < 3; a++) {
+		if (!bounds.same_sign[a]) {
+			continue;
+		}
+		const bool negative = bounds.inv_max[a] < 0.F;
+		const float near_plane = negative ? node.bounds_max[a] : node.bounds_min[a];
+		const float far_plane = negative ? node.bounds_min[a] : node.bounds_max[a];
+		const float near_lo = near_plane - bounds.origin_max[a], near_hi = near_plane - bounds.origin_min[a];
+		const float far_lo = far_plane - bounds.origin_max[a], far_hi = far_plane - bounds.origin_min[a];
+		enter = std::max(enter, std::min(std::min(near_lo * bounds.inv_min[a], near_lo * bounds.inv_max[a]),
+			std::min(near_hi * bounds.inv_min[a], near_hi * bounds.inv_max[a])));
+		exit = std::min(exit, std::max(std::max(far_lo * bounds.inv_min[a], far_lo * bounds.inv_max[a]),
+			std::max(far_hi * bounds.inv_min[a], far_hi * bounds.inv_max[a])));
+		if (exit < enter) {
+			return false;
+		}
+	}
+	return true;
+}
+
+//	Lanes of active whose own ray hits the node box before their t_max
+inline uint64_t Packet_Lane_Mask(const Linear_BVH_Node& node, const Ray_Packet& packet, uint64_t active, float t_min) {
+	uint64_t lanes = 0;
+#if defined(SIMD_AVX) || defined(SIMD_SSE)
+	for (int first = 0; first < packet.count; first += SIMD_WIDTH) {
+		const uint64_t group = active >> first & ((uint64_t(1) << SIMD_WIDTH) - 1);
+		if (group == 0) {
+			continue;
+		}
+		//	A NaN from a ray starting on an axis aligned plane is dropped by max and min,
+		//	which return their second operand, the running bound
+		Lane enter = Lane_Set(t_min);
+		Lane exit = Lane_Load(packet.t_max + first);
+		for (int a = 0; a < 3; a++) {
+			const Lane origin = Lane_Load(packet.origin[a] + first);
+			const Lane inv_dir = Lane_Load(packet.inv_dir[a] + first);
+			const Lane t0 = Lane_Mul(Lane_Sub(Lane_Set(node.bounds_min[a]), origin), inv_dir);
+			const Lane t1 = Lane_Mul(Lane_Sub(Lane_Set(node.bounds_max[a]), origin), inv_dir);
+			enter = Lane_Max(Lane_Min(t0, t1), enter);
+			exit = Lane_Min(Lane_Max(t0, t1), exit);
+		}
+		lanes |= (static_cast<uint64_t>(Lane_Mask(Lane_Less_Equal(enter, exit))) & group) << first;
+	}
+#else
+	for (int lane = 0; lane < packet.count; lane++) {
+		if (Lane_Active(active, lane) && Box_Hit(node, Point3f(packet.origin[0][lane], packet.origin[1][lane], packet.origin[2][lane]),
+			Vec3f(packet.inv_dir[0][lane], packet.inv_dir[1][lane], packet.inv_dir[2][lane]), t_min, packet.t_max[lane])) {
+			lanes |= uint64_t(1) << lane;
+		}
+	}
+#endif
+	return lanes;
+}
+
+//	Walks a Linear_BVH_Node tree for one ray, nearer child first. Leaves whose box the ray
+//	enters within [t_min, t_max] are handed to leaf(node), which may shorten t_max and returns
+//	true to end the walk, as an occlusion test does. Returns whether a leaf ended it.
+template <typename Leaf>
+inline bool Traverse_Ray(const std::vector<Linear_BVH_Node>& nodes, const Point3f& origin, const Vec3f& inv_dir, float t_min, const float& t_max, Leaf&& leaf) {
+	if (nodes.empty()) {
+		return false;
+	}
+	const bool dir_is_neg[3] = { inv_dir.x < 0, inv_dir.y < 0, inv_dir.z < 0 };
+
+	int to_visit[BVH_STACK_SIZE];
+	int to_visit_offset = 0;
+	int current = 0;
+	while (true) {
+		const Linear_BVH_Node& node = nodes[current];
+		if (Box_Hit(node, origin, inv_dir, t_min, t_max)) {
+			if (node.n_primitives > 0) {
+				if (leaf(node)) {
+					return true;
+				}
+				if (to_visit_offset == 0) {
+					break;
+				}
+				current = to_visit[--to_visit_offset];
+			}
+			else if (dir_is_neg[node.axis]) {
+				to_visit[to_visit_offset++] = current + 1;
+				current = node.second_child_offset;
+			}
+			else {
+				to_visit[to_visit_offset++] = node.second_child_offset;
+				current = current + 1;
+			}
+		}
+		else {
+			if (to_visit_offset == 0) {
+				break;
+			}
+			current = to_visit[--to_visit_offset];
+		}
+	}
+	return false;
+}
+
+//	Walks a Linear_BVH_Node tree once for every active lane of the packet, with one shared
+//	stack. Inner nodes are culled for the packet as a whole, leaves are handed to leaf(node,
+//	lanes) with the lanes that hit their box, which returns true when it shortened any t_max.
+//	Children are visited in the order of the first active lane.
+template <typename Leaf>
+inline void Traverse_Packet(const std::vector<Linear_BVH_Node>& nodes, Ray_Packet& packet, uint64_t active, float t_min, Leaf&& leaf) {
+	if (nodes.empty() || active == 0) {
+		return;
+	}
+	Packet_Bounds bounds(packet, active);
+	int first_lane = 0;
+	while (!Lane_Active(active, first_lane)) {
+		first_lane++;
+	}
+	const bool dir_is_neg[3] = { packet.inv_dir[0][first_lane] < 0, packet.inv_dir[1][first_lane] < 0, packet.inv_dir[2][first_lane] < 0 };
+
+	int to_visit[BVH_STACK_SIZE];
+	int to_visit_offset = 0;
+	int current = 0;
+	while (true) {
+		const Linear_BVH_Node& node = nodes[current];
+		if (Packet_Interval_Hit(node, bounds, t_min)) {
+			if (node.n_primitives > 0) {
+				const uint64_t lanes = Packet_Lane_Mask(node, packet, active, t_min);
+				if (lanes != 0 && leaf(node, lanes)) {
+					bounds.Update_Far(packet, active);
+				}
+				if (to_visit_offset == 0) {
+					break;
+				}
+				current = to_visit[--to_visit_offset];
+			}
+			else if (dir_is_neg[node.axis]) {
+				to_visit[to_visit_offset++] = current + 1;
+				current = node.second_child_offset;
+			}
+			else {
+				to_visit[to_visit_offset++] = node.second_child_offset;
+				current = current + 1;
+			}
+		}
+		else {
+			if (to_visit_offset == 0) {
+				break;
+			}
+			current = to_visit[--to_visit_offset];
+		}
+	}
+}
+
+//	Subtrees with at most this many primitives become one leaf when SAH says it is cheaper.
+//	Only Linear_BVH does this, its leaf triangles skip the virtual Hit that makes a Wide_BVH
+//	or Quantized_BVH leaf primitive cost as much as another box lane.
+constexpr int BVH_MAX_LEAF_SIZE = 8;
+
+struct BVH_Primitive;
+class Triangle;
+
+class Linear_BVH : public Hittable {
+public:
+	//	max_leaf_size 1 keeps the one primitive leaves of the tree being flattened
+	Linear_BVH(std::shared_ptr<Hittable> root, int max_leaf_size = BVH_MAX_LEAF_SIZE);
+
+	virtual bool Hit(const Ray& r, double t_min, double t_max, Hit_Record& rec) const override;
+	virtual bool Bounding_Box(AABB& output_box) const override;
+	virtual bool Occluded(const Ray& r, double t_min, double t_max) const override;
+	virtual uint64_t Hit_Packet(Ray_Packet& packet, uint64_t active, double t_min, Hit_Record* recs) const override;
+	virtual bool Packet_Traversal() const override { return true; }
+
+	//	Recomputes the node bounds after primitives have moved, keeping the topology. If the SAH
+	//	cost has grown past rebuild_threshold times its cost when built the tree is rebuilt
+	//	instead, 0 never rebuilds. Returns true when it rebuilt.
+	bool Refit(float rebuild_threshold = 0.F);
+	float SAH_Cost() const;
+
+public:
+	std::vector<Linear_BVH_Node> nodes;
+	std::vector<std::shared_ptr<Hittable>> primitives;
+	std::vector<const Triangle*> triangles;		//	per primitive, null unless it is a Triangle
+	float build_cost;
+	int max_leaf_size;
+
+private:
+	int Flatten(const std::shared_ptr<Hittable>& n, float& cost);
+	void Build(const std::shared_ptr<Hittable>& root);
+	AABB Refit_Node(int index, int parallel_depth);
+};
+//	Top down binned SAH build of prims[start, end) appended to nodes in depth first order, for
+//	primitives tested block_width at a time. Leaves hold at most max_leaf_size primitives and
+//	index prims directly, the caller reorders its primitives to match. The tree never gets
+//	deeper than BVH_STACK_SIZE. Returns the node offset.
+int Build_Block_Tree(std::vector<Linear_BVH_Node>& nodes, std::vector<BVH_Primitive>& prims, size_t start, size_t end, int max_leaf_size, int block_width, int depth = 0);
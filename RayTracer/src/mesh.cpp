@@ -0,0 +1,465 @@
+#include "mesh.h"
+#include "bvh.h"
+#include "timer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+uint32_t Octahedral_Encode(const Vec3f& n) {
+	const float l1 = std::fabs(n.x) + std::fabs(n.y) + std::fabs(n.z);
+	if (l1 == 0.F) {
+		return Octahedral_Encode(Vec3f(0, 0, 1));
+	}
+	float u = n.x / l1;
+	float v = n.y / l1;
+	//	The lower half folds out over the corners of the upper one
+	if (n.z < 0.F) {
+		const float folded_u = (1.F - std::fabs(v)) * (u >= 0.F ? 1.F : -1.F);
+		v = (1.F - std::fabs(u)) * (v >= 0.F ? 1.F : -1.F);
+		u = folded_u;
+	}
+	auto quantize = [](float x) {
+		return static_cast<uint32_t>(std::lround((std::min(std::max(x, -1.F), 1.F) * 0.5F + 0.5F) * 65535.F));
+	};
+	return quantize(u) | quantize(v) << 16;
+}
+
+Vec3f Octahedral_Decode(uint32_t code) {
+	Vec3f n((code & 0xFFFF) / 65535.F * 2.F - 1.F, (code >> 16) / 65535.F * 2.F - 1.F, 0.F);
+	n.z = 1.F - std::fabs(n.x) - std::fabs(n.y);
+	const float fold = std::max(-n.z, 0.F);
+	n.x += n.x >= 0.F ? -fold : fold;
+	n.y += n.y >= 0.F ? -fold : fold;
+	return n.normalize();
+}
+
+Mesh::Mesh(const std::vector<Vec3f>& positions, const std::vector<Vec3f>& normals, std::vector<uint32_t> indices,
+	std::vector<uint16_t> triangle_materials, std::vector<std::shared_ptr<Material>> materials, int encoding, int max_leaf_size)
+	: indices(std::move(indices)), material_index(std::move(triangle_materials)), materials(std::move(materials)),
+	triangle_count(material_index.size()), encoding(encoding), max_leaf_size(max_leaf_size) {
+	Timer t("Mesh build time: ");
+	px.reserve(positions.size());
+	py.reserve(positions.size());
+	pz.reserve(positions.size());
+	for (const auto& p : positions) {
+		px.push_back(p.x);
+		py.push_back(p.y);
+		pz.push_back(p.z);
+	}
+	if (encoding == COMPRESSED_VERTICES) {
+		octahedral_normals.reserve(normals.size());
+		for (const auto& n : normals) {
+			octahedral_normals.push_back(Octahedral_Encode(n));
+		}
+	}
+	else {
+		nx.reserve(normals.size());
+		ny.reserve(normals.size());
+		nz.reserve(normals.size());
+		for (const auto& n : normals) {
+			nx.push_back(n.x);
+			ny.push_back(n.y);
+			nz.push_back(n.z);
+		}
+	}
+	//	Boxes are taken from the snapped positions so they bound what the leaves decode to
+	const std::vector<uint16_t> quantized = encoding == COMPRESSED_VERTICES ? Quantize_Positions() : std::vector<uint16_t>();
+
+	const size_t count = Triangle_Count();
+	std::vector<BVH_Primitive> prims(count);
+	for (size_t i = 0; i < count; i++) {
+		const Vec3f v0 = Position(this->indices[3 * i]);
+		const Vec3f v1 = Position(this->indices[3 * i + 1]);
+		const Vec3f v2 = Position(this->indices[3 * i + 2]);
+		prims[i].box = Enclosing_Box(AABB(v0, v0), Enclosing_Box(AABB(v1, v1), AABB(v2, v2)));
+		prims[i].centroid = prims[i].box.Centroid();
+		prims[i].index = i;
+	}
+	if (count == 0) {
+		return;
+	}
+	nodes.reserve(2 * count / std::max(1, max_leaf_size) + 1);
+	Build_Block_Tree(nodes, prims, 0, count, max_leaf_size, MESH_BLOCK_WIDTH);
+
+	//	Leaves hold their own copy of every corner, whichever the encoding
+	Pack_Blocks(prims, quantized);
+	std::vector<float>().swap(px);
+	std::vector<float>().swap(py);
+	std::vector<float>().swap(pz);
+	std::cerr << "Mesh memory: " << Bytes() / 1024 << " KB for " << count << " triangles\n";
+}
+
+std::vector<uint16_t> Mesh::Quantize_Positions() {
+	const size_t vertex_count = px.size();
+	std::vector<float>* axes[3] = { &px, &py, &pz };
+	std::vector<uint16_t> quantized(3 * vertex_count);
+	for (int a = 0; a < 3; a++) {
+		std::vector<float>& p = *axes[a];
+		if (vertex_count == 0) {
+			break;
+		}
+		const auto bounds = std::minmax_element(p.begin(), p.end());
+		quantize_min[a] = *bounds.first;
+		quantize_scale[a] = (*bounds.second - *bounds.first) / 65535.F;
+		for (size_t i = 0; i < vertex_count; i++) {
+			const float q = quantize_scale[a] > 0.F ? std::round((p[i] - quantize_min[a]) / quantize_scale[a]) : 0.F;
+			quantized[3 * i + a] = static_cast<uint16_t>(std::min(std::max(q, 0.F), 65535.F));
+			//	Same expression Leaf_Block decodes with, so the tree bounds the decoded triangles
+			p[i] = quantize_min[a] + quantized[3 * i + a] * quantize_scale[a];
+		}
+	}
+	return quantized;
+}
+
+void Mesh::Pack_Blocks(const std::vector<BVH_Primitive>& prims, const std::vector<uint16_t>& quantized) {
+	const bool compressed = encoding == COMPRESSED_VERTICES;
+	size_t block_count = 0;
+	for (const auto& node : nodes) {
+		block_count += (node.n_primitives + MESH_BLOCK_WIDTH - 1) / MESH_BLOCK_WIDTH;
+	}
+	std::vector<uint32_t> sorted_indices;
+	std::vector<uint16_t> sorted_materials;
+	sorted_indices.reserve(3 * block_count * MESH_BLOCK_WIDTH);
+	sorted_materials.reserve(block_count * MESH_BLOCK_WIDTH);
+	blocks.clear();
+	quantized_blocks.clear();
+	if (compressed) {
+		quantized_blocks.reserve(block_count);
+	}
+	else {
+		blocks.reserve(block_count);
+	}
+
+	//	Depth first order visits the leaves in the order their ranges of prims were built
+	for (auto& node : nodes) {
+		if (node.n_primitives == 0) {
+			continue;
+		}
+		const size_t start = node.primitives_offset;
+		node.primitives_offset = static_cast<int>(sorted_materials.size());
+		for (size_t i = start; i < start + node.n_primitives; i++) {
+			const size_t src = prims[i].index;
+			const int lane = sorted_materials.size() % MESH_BLOCK_WIDTH;
+			if (compressed) {
+				if (lane == 0) {
+					quantized_blocks.push_back(Quantized_Block{});
+				}
+				Quantized_Block& block = quantized_blocks.back();
+				for (int k = 0; k < 3; k++) {
+					for (int a = 0; a < 3; a++) {
+						block.v[k][a][lane] = quantized[3 * indices[3 * src + k] + a];
+					}
+					sorted_indices.push_back(indices[3 * src + k]);
+				}
+				sorted_materials.push_back(material_index[src]);
+				continue;
+			}
+			if (lane == 0) {
+				blocks.push_back(Triangle_Block{});
+			}
+			Triangle_Block& block = blocks.back();
+			const Vec3f v0 = Position(indices[3 * src]);
+			const Vec3f e1 = Position(indices[3 * src + 1]) - v0;
+			const Vec3f e2 = Position(indices[3 * src + 2]) - v0;
+			const Vec3f normal = e1.crossProduct(e2);
+			for (int a = 0; a < 3; a++) {
+				block.v0[a][lane] = v0[a];
+				block.e1[a][lane] = e1[a];
+				block.e2[a][lane] = e2[a];
+				block.normal[a][lane] = normal[a];
+			}
+			for (int k = 0; k < 3; k++) {
+				sorted_indices.push_back(indices[3 * src + k]);
+			}
+			sorted_materials.push_back(material_index[src]);
+		}
+		//	Pad to the end of the block, the zeroed lanes never hit, nor do quantized ones whose
+		//	corners all decode to the same point
+		while (sorted_materials.size() % MESH_BLOCK_WIDTH != 0) {
+			for (int k = 0; k < 3; k++) {
+				sorted_indices.push_back(0);
+			}
+			sorted_materials.push_back(0);
+		}
+	}
+	indices.swap(sorted_indices);
+	material_index.swap(sorted_materials);
+}
+
+//	Ray broadcast to every lane of a block test
+struct Ray_Lanes {
+	float origin[3];
+	float dir[3];
+};
+
+#if defined(SIMD_AVX) || defined(SIMD_SSE)
+//	Same one sided test as Triangle::Intersect on every lane, returns the mask of lanes hit
+//	within [t_min, t_max]
+inline Lane Block_Hits(const Triangle_Block& block, const Ray_Lanes& r, float t_min, float t_max, Lane& t, Lane& u, Lane& v) {
+	const Lane zero = Lane_Set(0.F);
+	const Lane dx = Lane_Set(r.dir[0]), dy = Lane_Set(r.dir[1]), dz = Lane_Set(r.dir[2]);
+	const Lane nx = Lane_Load(block.normal[0]), ny = Lane_Load(block.normal[1]), nz = Lane_Load(block.normal[2]);
+
+	const Lane det = Lane_Sub(zero, Lane_Add(Lane_Add(Lane_Mul(dx, nx), Lane_Mul(dy, ny)), Lane_Mul(dz, nz)));
+	const Lane inv_det = Lane_Div(Lane_Set(1.F), det);
+
+	const Lane tx = Lane_Sub(Lane_Set(r.origin[0]), Lane_Load(block.v0[0]));
+	const Lane ty = Lane_Sub(Lane_Set(r.origin[1]), Lane_Load(block.v0[1]));
+	const Lane tz = Lane_Sub(Lane_Set(r.origin[2]), Lane_Load(block.v0[2]));
+	const Lane qx = Lane_Sub(Lane_Mul(ty, dz), Lane_Mul(tz, dy));
+	const Lane qy = Lane_Sub(Lane_Mul(tz, dx), Lane_Mul(tx, dz));
+	const Lane qz = Lane_Sub(Lane_Mul(tx, dy), Lane_Mul(ty, dx));
+
+	u = Lane_Mul(Lane_Add(Lane_Add(Lane_Mul(Lane_Load(block.e2[0]), qx), Lane_Mul(Lane_Load(block.e2[1]), qy)), Lane_Mul(Lane_Load(block.e2[2]), qz)), inv_det);
+	v = Lane_Mul(Lane_Sub(zero, Lane_Add(Lane_Add(Lane_Mul(Lane_Load(block.e1[0]), qx), Lane_Mul(Lane_Load(block.e1[1]), qy)), Lane_Mul(Lane_Load(block.e1[2]), qz))), inv_det);
+	t = Lane_Mul(Lane_Add(Lane_Add(Lane_Mul(tx, nx), Lane_Mul(ty, ny)), Lane_Mul(tz, nz)), inv_det);
+
+	Lane mask = Lane_Less_Equal(Lane_Set(0.00001F), det);
+	mask = Lane_And(mask, Lane_Less_Equal(zero, u));
+	mask = Lane_And(mask, Lane_Less_Equal(zero, v));
+	mask = Lane_And(mask, Lane_Less_Equal(Lane_Add(u, v), Lane_Set(1.F)));
+	mask = Lane_And(mask, Lane_Less_Equal(Lane_Set(t_min), t));
+	return Lane_And(mask, Lane_Less_Equal(t, Lane_Set(t_max)));
+}
+
+//	Closest lane hit within [t_min, t_max] or -1, found with a masked horizontal min
+inline int Closest_In_Block(const Triangle_Block& block, const Ray_Lanes& r, float t_min, float t_max, float& t, float& u, float& v) {
+	Lane lane_t, lane_u, lane_v;
+	const Lane mask = Block_Hits(block, r, t_min, t_max, lane_t, lane_u, lane_v);
+	if (Lane_Mask(mask) == 0) {
+		return -1;
+	}
+	const Lane masked_t = Lane_Select(mask, lane_t, Lane_Set(std::numeric_limits<float>::infinity()));
+	const int nearest = Lane_Mask(Lane_And(mask, Lane_Equal(masked_t, Lane_Horizontal_Min(masked_t))));
+	int lane = 0;
+	while (!(nearest & (1 << lane))) {
+		lane++;
+	}
+	float ts[MESH_BLOCK_WIDTH], us[MESH_BLOCK_WIDTH], vs[MESH_BLOCK_WIDTH];
+	std::memcpy(ts, &lane_t, sizeof(ts));
+	std::memcpy(us, &lane_u, sizeof(us));
+	std::memcpy(vs, &lane_v, sizeof(vs));
+	t = ts[lane];
+	u = us[lane];
+	v = vs[lane];
+	return lane;
+}
+
+inline bool Any_In_Block(const Triangle_Block& block, const Ray_Lanes& r, float t_min, float t_max) {
+	Lane t, u, v;
+	return Lane_Mask(Block_Hits(block, r, t_min, t_max, t, u, v)) != 0;
+}
+#else
+inline bool Lane_Hit(const Triangle_Block& block, int lane, const Ray_Lanes& r, float t_min, float t_max, float& t, float& u, float& v) {
+	const Vec3f dir(r.dir[0], r.dir[1], r.dir[2]);
+	const Vec3f normal(block.normal[0][lane], block.normal[1][lane], block.normal[2][lane]);
+	float det = -dir.dotProduct(normal);
+	if (!(det >= 0.00001F)) {
+		return false;
+	}
+	float inv_det = 1 / det;
+
+	const Vec3f tvec(r.origin[0] - block.v0[0][lane], r.origin[1] - block.v0[1][lane], r.origin[2] - block.v0[2][lane]);
+	const Vec3f qvec = tvec.crossProduct(dir);
+	u = Vec3f(block.e2[0][lane], block.e2[1][lane], block.e2[2][lane]).dotProduct(qvec) * inv_det;
+	if (u < 0 || u > 1) {
+		return false;
+	}
+	v = -Vec3f(block.e1[0][lane], block.e1[1][lane], block.e1[2][lane]).dotProduct(qvec) * inv_det;
+	if (v < 0 || u + v > 1) {
+		return false;
+	}
+	t = tvec.dotProduct(normal) * inv_det;
+	return t >= t_min && t <= t_max;
+}
+
+inline int Closest_In_Block(const Triangle_Block& block, const Ray_Lanes& r, float t_min, float t_max, float& t, float& u, float& v) {
+	int closest = -1;
+	for (int lane = 0; lane < MESH_BLOCK_WIDTH; lane++) {
+		float lane_t, lane_u, lane_v;
+		if (Lane_Hit(block, lane, r, t_min, t_max, lane_t, lane_u, lane_v)) {
+			t_max = lane_t;
+			t = lane_t;
+			u = lane_u;
+			v = lane_v;
+			closest = lane;
+		}
+	}
+	return closest;
+}
+
+inline bool Any_In_Block(const Triangle_Block& block, const Ray_Lanes& r, float t_min, float t_max) {
+	for (int lane = 0; lane < MESH_BLOCK_WIDTH; lane++) {
+		float t, u, v;
+		if (Lane_Hit(block, lane, r, t_min, t_max, t, u, v)) {
+			return true;
+		}
+	}
+	return false;
+}
+#endif
+
+const Triangle_Block& Mesh::Leaf_Block(int b, Triangle_Block& scratch) const {
+	if (encoding != COMPRESSED_VERTICES) {
+		return blocks[b];
+	}
+	const Quantized_Block& block = quantized_blocks[b];
+#if defined(SIMD_AVX) || defined(SIMD_SSE)
+	Lane v[3][3];
+	for (int k = 0; k < 3; k++) {
+		for (int a = 0; a < 3; a++) {
+			v[k][a] = Lane_Add(Lane_Set(quantize_min[a]), Lane_Mul(Lane_Load_U16(block.v[k][a]), Lane_Set(quantize_scale[a])));
+		}
+	}
+	Lane e1[3], e2[3];
+	for (int a = 0; a < 3; a++) {
+		e1[a] = Lane_Sub(v[1][a], v[0][a]);
+		e2[a] = Lane_Sub(v[2][a], v[0][a]);
+		Lane_Store(scratch.v0[a], v[0][a]);
+		Lane_Store(scratch.e1[a], e1[a]);
+		Lane_Store(scratch.e2[a], e2[a]);
+	}
+	Lane_Store(scratch.normal[0], Lane_Sub(Lane_Mul(e1[1], e2[2]), Lane_Mul(e1[2], e2[1])));
+	Lane_Store(scratch.normal[1], Lane_Sub(Lane_Mul(e1[2], e2[0]), Lane_Mul(e1[0], e2[2])));
+	Lane_Store(scratch.normal[2], Lane_Sub(Lane_Mul(e1[0], e2[1]), Lane_Mul(e1[1], e2[0])));
+#else
+	for (int lane = 0; lane < MESH_BLOCK_WIDTH; lane++) {
+		Vec3f v[3];
+		for (int k = 0; k < 3; k++) {
+			for (int a = 0; a < 3; a++) {
+				v[k][a] = quantize_min[a] + block.v[k][a][lane] * quantize_scale[a];
+			}
+		}
+		const Vec3f e1 = v[1] - v[0];
+		const Vec3f e2 = v[2] - v[0];
+		const Vec3f normal = e1.crossProduct(e2);
+		for (int a = 0; a < 3; a++) {
+			scratch.v0[a][lane] = v[0][a];
+			scratch.e1[a][lane] = e1[a];
+			scratch.e2[a][lane] = e2[a];
+			scratch.normal[a][lane] = normal[a];
+		}
+	}
+#endif
+	return scratch;
+}
+
+bool Mesh::Hit(const Ray& r, double t_min, double t_max, Hit_Record& rec) const {
+	const Point3f origin = r.Origin();
+	const Vec3f dir = r.Direction();
+	const Vec3f inv_dir(1.F / dir.x, 1.F / dir.y, 1.F / dir.z);
+	const Ray_Lanes lanes = { { origin.x, origin.y, origin.z }, { dir.x, dir.y, dir.z } };
+
+	float closest_so_far = static_cast<float>(t_max);
+	int closest_triangle = -1;
+	float hit_u = 0.F, hit_v = 0.F;
+	Triangle_Block scratch;
+	Traverse_Ray(nodes, origin, inv_dir, static_cast<float>(t_min), closest_so_far, [&](const Linear_BVH_Node& node) {
+		const int first = node.primitives_offset / MESH_BLOCK_WIDTH;
+		const int end = first + (node.n_primitives + MESH_BLOCK_WIDTH - 1) / MESH_BLOCK_WIDTH;
+		for (int b = first; b < end; b++) {
+			float t, u, v;
+			int lane = Closest_In_Block(Leaf_Block(b, scratch), lanes, static_cast<float>(t_min), closest_so_far, t, u, v);
+			if (lane >= 0) {
+				closest_so_far = t;
+				closest_triangle = b * MESH_BLOCK_WIDTH + lane;
+				hit_u = u;
+				hit_v = v;
+			}
+		}
+		return false;
+	});
+	if (closest_triangle < 0) {
+		return false;
+	}
+
+	const uint32_t* tri = &indices[3 * closest_triangle];
+	rec.p = r.At(closest_so_far);
+	rec.t = closest_so_far;
+	rec.normal = Normal(tri[1]) * hit_u + Normal(tri[2]) * hit_v + Normal(tri[0]) * (1.0F - hit_u - hit_v);
+	rec.mat_ptr = materials[material_index[closest_triangle]];
+	return true;
+}
+
+uint64_t Mesh::Hit_Packet(Ray_Packet& packet, uint64_t active, double t_min, Hit_Record* recs) const {
+	int closest_triangle[PACKET_SIZE];
+	float hit_u[PACKET_SIZE], hit_v[PACKET_SIZE];
+	uint64_t hits = 0;
+	Triangle_Block scratch;
+
+	Traverse_Packet(nodes, packet, active, static_cast<float>(t_min), [&](const Linear_BVH_Node& node, uint64_t lanes) {
+		uint64_t leaf_hits = 0;
+		const int first = node.primitives_offset / MESH_BLOCK_WIDTH;
+		const int end = first + (node.n_primitives + MESH_BLOCK_WIDTH - 1) / MESH_BLOCK_WIDTH;
+		for (int b = first; b < end; b++) {
+			const Triangle_Block& block = Leaf_Block(b, scratch);
+			for (int lane = 0; lane < packet.count; lane++) {
+				if (!Lane_Active(lanes, lane)) {
+					continue;
+				}
+				const Ray_Lanes r = { { packet.origin[0][lane], packet.origin[1][lane], packet.origin[2][lane] },
+					{ packet.dir[0][lane], packet.dir[1][lane], packet.dir[2][lane] } };
+				float t, u, v;
+				const int hit = Closest_In_Block(block, r, static_cast<float>(t_min), packet.t_max[lane], t, u, v);
+				if (hit >= 0) {
+					packet.t_max[lane] = t;
+					closest_triangle[lane] = b * MESH_BLOCK_WIDTH + hit;
+					hit_u[lane] = u;
+					hit_v[lane] = v;
+					leaf_hits |= uint64_t(1) << lane;
+				}
+			}
+		}
+		hits |= leaf_hits;
+		return leaf_hits != 0;
+	});
+
+	for (int lane = 0; lane < packet.count; lane++) {
+		if (!Lane_Active(hits, lane)) {
+			continue;
+		}
+		const uint32_t* tri = &indices[3 * closest_triangle[lane]];
+		Hit_Record& rec = recs[lane];
+		rec.t = packet.t_max[lane];
+		rec.p = packet.Lane_Ray(lane).At(rec.t);
+		rec.normal = Normal(tri[1]) * hit_u[lane] + Normal(tri[2]) * hit_v[lane] + Normal(tri[0]) * (1.0F - hit_u[lane] - hit_v[lane]);
+		rec.mat_ptr = materials[material_index[closest_triangle[lane]]];
+	}
+	return hits;
+}
+
+bool Mesh::Occluded(const Ray& r, double t_min, double t_max) const {
+	const Point3f origin = r.Origin();
+	const Vec3f dir = r.Direction();
+	const Vec3f inv_dir(1.F / dir.x, 1.F / dir.y, 1.F / dir.z);
+	const Ray_Lanes lanes = { { origin.x, origin.y, origin.z }, { dir.x, dir.y, dir.z } };
+
+	const float t_far = static_cast<float>(t_max);
+	Triangle_Block scratch;
+	return Traverse_Ray(nodes, origin, inv_dir, static_cast<float>(t_min), t_far, [&](const Linear_BVH_Node& node) {
+		const int first = node.primitives_offset / MESH_BLOCK_WIDTH;
+		const int end = first + (node.n_primitives + MESH_BLOCK_WIDTH - 1) / MESH_BLOCK_WIDTH;
+		for (int b = first; b < end; b++) {
+			if (Any_In_Block(Leaf_Block(b, scratch), lanes, static_cast<float>(t_min), t_far)) {
+				return true;
+			}
+		}
+		return false;
+	});
+}
+
+bool Mesh::Bounding_Box(AABB& output_box) const {
+	if (nodes.empty()) {
+		return false;
+	}
+	output_box = Node_Box(nodes.front());
+	return true;
+}
+
+size_t Mesh::Bytes() const {
+	return (px.capacity() + py.capacity() + pz.capacity() + nx.capacity() + ny.capacity() + nz.capacity()) * sizeof(float)
+		+ indices.capacity() * sizeof(uint32_t) + material_index.capacity() * sizeof(uint16_t)
+		+ nodes.capacity() * sizeof(Linear_BVH_Node) + blocks.capacity() * sizeof(Triangle_Block)
+		+ quantized_blocks.capacity() * sizeof(Quantized_Block) + octahedral_normals.capacity() * sizeof(uint32_t);
+}
@@ -0,0 +1,89 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "enum.h"
+#include "hittable.h"
+#include "linear_bvh.h"
+#include "simd.h"
+
+struct BVH_Primitive;
+
+//	Leaves test one ray against a whole block of triangles at once
+constexpr int MESH_BLOCK_WIDTH = SIMD_WIDTH;
+
+//	Structure of arrays copy of the triangles of a leaf, one lane per triangle. Lanes past the
+//	end of a leaf are zero, which the determinant test always rejects.
+struct Triangle_Block {
+	float v0[3][MESH_BLOCK_WIDTH];
+	float e1[3][MESH_BLOCK_WIDTH];
+	float e2[3][MESH_BLOCK_WIDTH];
+	float normal[3][MESH_BLOCK_WIDTH];
+};
+
+//	Leaf triangles of a COMPRESSED_VERTICES mesh as their three corners, each coordinate
+//	quantized to 16 bits of the mesh bounds. Decoded into a Triangle_Block when the leaf is hit.
+struct Quantized_Block {
+	uint16_t v[3][3][MESH_BLOCK_WIDTH];		//	corner, axis, lane
+};
+
+//	Unit normal folded onto an octahedron, two 16 bit coordinates in one word
+uint32_t Octahedral_Encode(const Vec3f& n);
+Vec3f Octahedral_Decode(uint32_t code);
+
+//	Triangle mesh kept as shared structure of arrays vertex buffers and a 32 bit index buffer,
+//	in place of one Triangle object per face. It carries its own Linear_BVH_Node tree whose
+//	leaves are ranges of triangles, the index buffer is sorted into leaf order at build time
+//	and every leaf starts on a block boundary, padded with degenerate triangles.
+//	COMPRESSED_VERTICES trades precision for memory: positions snap to a 65536 step grid over
+//	the mesh bounds and normals keep about 15 bits per octahedral coordinate, decoded only for
+//	the closest hit. Leaves are then about 18 bytes per triangle instead of 48.
+class Mesh : public Hittable {
+public:
+	//	Three indices per triangle into positions and normals, which are indexed alike, and one
+	//	entry of triangle_materials per triangle indexing materials
+	Mesh(const std::vector<Vec3f>& positions, const std::vector<Vec3f>& normals, std::vector<uint32_t> indices,
+		std::vector<uint16_t> triangle_materials, std::vector<std::shared_ptr<Material>> materials,
+		int encoding = FLOAT_VERTICES, int max_leaf_size = BVH_MAX_LEAF_SIZE);
+
+	virtual bool Hit(const Ray& r, double t_min, double t_max, Hit_Record& rec) const override;
+	virtual bool Bounding_Box(AABB& output_box) const override;
+	virtual bool Occluded(const Ray& r, double t_min, double t_max) const override;
+	virtual uint64_t Hit_Packet(Ray_Packet& packet, uint64_t active, double t_min, Hit_Record* recs) const override;
+	virtual bool Packet_Traversal() const override { return true; }
+
+	size_t Triangle_Count() const { return triangle_count; }
+	//	Geometry, index and tree memory
+	size_t Bytes() const;
+
+public:
+	//	Released once Pack_Blocks has copied the corners into the leaves
+	std::vector<float> px, py, pz;
+	std::vector<float> nx, ny, nz;
+	std::vector<uint32_t> indices;
+	std::vector<uint16_t> material_index;
+	std::vector<std::shared_ptr<Material>> materials;
+	std::vector<Linear_BVH_Node> nodes;
+	std::vector<Triangle_Block> blocks;		//	triangle i is lane i % MESH_BLOCK_WIDTH of block i / MESH_BLOCK_WIDTH
+	size_t triangle_count;
+	int encoding;
+	int max_leaf_size;
+
+	//	COMPRESSED_VERTICES only, in place of blocks and nx, ny, nz
+	std::vector<Quantized_Block> quantized_blocks;
+	std::vector<uint32_t> octahedral_normals;
+	float quantize_min[3] = {};
+	float quantize_scale[3] = {};
+
+private:
+	inline Vec3f Position(uint32_t i) const { return Vec3f(px[i], py[i], pz[i]); }
+	inline Vec3f Normal(uint32_t i) const {
+		return encoding == COMPRESSED_VERTICES ? Octahedral_Decode(octahedral_normals[i]) : Vec3f(nx[i], ny[i], nz[i]);
+	}
+	//	Snaps px, py, pz to the quantization grid and returns the grid coordinates, three per vertex
+	std::vector<uint16_t> Quantize_Positions();
+	//	Sorts the triangles into leaf order with every leaf padded to whole blocks
+	void Pack_Blocks(const std::vector<BVH_Primitive>& prims, const std::vector<uint16_t>& quantized);
+	//	Block b ready for the ray test, decoded into scratch for a compressed mesh
+	const Triangle_Block& Leaf_Block(int b, Triangle_Block& scratch) const;
+};
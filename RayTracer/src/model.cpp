@@ -3,10 +3,29 @@
 #include <fstream>
 #include <sstream>
 #include <vector>
+#include <tuple>
 #include "model.h"
+#include "instance.h"
+#include "tree.h"
+#include "mesh.h"
+#include "Sphere.h"
+#include "quad.h"
+#include <algorithm>
+#include <cmath>
 
-Model::Model(std::string filename) {
+Model::Model(std::string filename, int builder, int layout, int encoding, float proxy_tolerance)
+	: builder(builder), layout(layout), encoding(encoding) {
 	LoadModel(filename + ".obj");
+	if (proxy_tolerance > 0.F && !tris_.empty()) {
+		if (Fit_Sphere(proxy_tolerance)) {
+			proxy = SPHERE_PROXY;
+			std::cerr << "# fitted by a sphere of radius " << proxy_radius << std::endl;
+		}
+		else if (Fit_Quad(proxy_tolerance)) {
+			proxy = QUAD_PROXY;
+			std::cerr << "# fitted by a quad" << std::endl;
+		}
+	}
 }
 
 int Model::nverts() {
@@ -94,8 +113,28 @@ void Model::LoadModel(std::string filename) {
 	std::cerr << "# v# " << verts_.size() << " f# " << tris_.size() << std::endl;
 }
 
-void Model::AddToWorld(Hittable_List& world, Vec3f transform, const std::shared_ptr<Material>& mat, int index)
+std::shared_ptr<Hittable> Model::BLAS(const std::shared_ptr<Material>& mat, int index)
 {
+	if (blas) {
+		return blas;
+	}
+	const bool indexed = proxy == NO_PROXY && layout == LINEAR_BVH && builder == SAH_BUILDER;
+	if (encoding == COMPRESSED_VERTICES && !indexed) {
+		std::cerr << "COMPRESSED_VERTICES ignored, only a LINEAR_BVH from the SAH builder without a proxy is an indexed Mesh\n";
+	}
+	if (proxy == SPHERE_PROXY) {
+		blas = std::make_shared<Sphere>(proxy_centre, proxy_radius, mat, index);
+		return blas;
+	}
+	if (proxy == QUAD_PROXY) {
+		blas = std::make_shared<Quad>(proxy_corner, proxy_u, proxy_v, mat, index);
+		return blas;
+	}
+	if (indexed) {
+		blas = Indexed_Mesh(mat);
+		return blas;
+	}
+	Hittable_List mesh;
 	for(auto& tri : tris_){
 		const Vec3f v0 = verts_[tri.vertexIndex[0]];
 		const Vec3f v1 = verts_[tri.vertexIndex[1]];
@@ -105,8 +144,171 @@ void Model::AddToWorld(Hittable_List& world, Vec3f transform, const std::shared_
 		const Vec3f v1n = vertNorms_[tri.vertexNormalsIndex[1]];
 		const Vec3f v2n = vertNorms_[tri.vertexNormalsIndex[2]];
 
-		world.Add(std::make_shared<Triangle>(v0 + transform, v1 + transform, v2 + transform, v0n, v1n, v2n, mat, index));
+		mesh.Add(std::make_shared<Triangle>(v0, v1, v2, v0n, v1n, v2n, mat, index));
+	}
+	blas = Build_Accelerator(mesh, builder, layout);
+	return blas;
+}
+
+float Model::Surface_Area(Vec3f& winding) const
+{
+	float area = 0.F;
+	winding = Vec3f(0, 0, 0);
+	for (const auto& face : tris_) {
+		const Vec3f& v0 = verts_[face.vertexIndex[0]];
+		for (size_t k = 2; k < face.vertexIndex.size(); k++) {
+			const Vec3f n = (verts_[face.vertexIndex[k - 1]] - v0).crossProduct(verts_[face.vertexIndex[k]] - v0);
+			area += 0.5F * n.length();
+			winding += n;
+		}
+	}
+	return area;
+}
+
+bool Model::Fit_Sphere(float tolerance)
+{
+	//	Flat facets of a tessellated sphere sink a little below it, those of a cube or other
+	//	solid whose corners happen to lie on a sphere sink far more
+	constexpr float max_facet_depth = 0.05F;
+	//	and together they must cover about all of it, not just a band
+	constexpr float min_coverage = 0.9F;
+
+	Vec3f centre(0, 0, 0);
+	for (const auto& v : verts_) {
+		centre += v;
+	}
+	centre = centre / static_cast<float>(verts_.size());
+	float radius = 0.F;
+	for (const auto& v : verts_) {
+		radius += (v - centre).length();
+	}
+	radius /= verts_.size();
+	if (radius <= 0.F) {
+		return false;
+	}
+	for (const auto& v : verts_) {
+		if (std::fabs((v - centre).length() - radius) > tolerance * radius) {
+			return false;
+		}
+	}
+	for (const auto& face : tris_) {
+		Vec3f face_centre(0, 0, 0);
+		for (int i : face.vertexIndex) {
+			face_centre += verts_[i];
+		}
+		face_centre = face_centre / static_cast<float>(face.vertexIndex.size());
+		if ((face_centre - centre).length() < (1.F - max_facet_depth) * radius) {
+			return false;
+		}
+	}
+	Vec3f winding;
+	if (Surface_Area(winding) < min_coverage * 4.F * static_cast<float>(pi) * radius * radius) {
+		return false;
+	}
+	proxy_centre = centre;
+	proxy_radius = radius;
+	return true;
+}
+
+bool Model::Fit_Quad(float tolerance)
+{
+	//	Corners of a parallelogram: the vertex farthest from the centroid, the one farthest
+	//	from it across the diagonal and the one farthest off that diagonal
+	Vec3f centroid(0, 0, 0);
+	for (const auto& v : verts_) {
+		centroid += v;
+	}
+	centroid = centroid / static_cast<float>(verts_.size());
+	auto farthest = [this](auto distance) {
+		return *std::max_element(verts_.begin(), verts_.end(), [&](const Vec3f& a, const Vec3f& b) { return distance(a) < distance(b); });
+	};
+	const Vec3f p0 = farthest([&](const Vec3f& p) { return (p - centroid).norm(); });
+	const Vec3f p2 = farthest([&](const Vec3f& p) { return (p - p0).norm(); });
+	const Vec3f diagonal = p2 - p0;
+	const Vec3f p1 = farthest([&](const Vec3f& p) { return (p - p0).crossProduct(diagonal).norm(); });
+
+	Vec3f u = p1 - p0;
+	Vec3f v = p2 - p1;
+	Vec3f normal = u.crossProduct(v);
+	const float area = normal.length();
+	const float size = diagonal.length();
+	if (area <= 0.F) {
+		return false;
+	}
+	normal = normal / area;
+
+	//	Every vertex in the plane and inside the parallelogram
+	const Vec3f w = u.crossProduct(v) / (area * area);
+	for (const auto& p : verts_) {
+		const Vec3f planar = p - p0;
+		if (std::fabs(planar.dotProduct(normal)) > tolerance * size) {
+			return false;
+		}
+		const float alpha = w.dotProduct(planar.crossProduct(v));
+		const float beta = w.dotProduct(u.crossProduct(planar));
+		if (alpha < -tolerance || alpha > 1.F + tolerance || beta < -tolerance || beta > 1.F + tolerance) {
+			return false;
+		}
+	}
+	//	and the faces cover it once, without holes or folds
+	Vec3f winding;
+	if (std::fabs(Surface_Area(winding) - area) > tolerance * area) {
+		return false;
+	}
+	//	Face the same way as the triangles did
+	if (winding.dotProduct(normal) < 0.F) {
+		std::swap(u, v);
+	}
+	proxy_corner = p0;
+	proxy_u = u;
+	proxy_v = v;
+	return true;
+}
+
+std::shared_ptr<Hittable> Model::Indexed_Mesh(const std::shared_ptr<Material>& mat)
+{
+	//	obj faces index positions and normals separately, the mesh shares one index between
+	//	them so every distinct pair becomes a vertex. Exporters tend to write a normal per face
+	//	corner, so equal normals are merged first or nearly every corner would be its own vertex.
+	std::map<std::tuple<float, float, float>, int> normal_of;
+	std::vector<int> unique_normal(vertNorms_.size());
+	for (size_t i = 0; i < vertNorms_.size(); i++) {
+		const Vec3f& n = vertNorms_[i];
+		unique_normal[i] = normal_of.emplace(std::make_tuple(n.x, n.y, n.z), static_cast<int>(i)).first->second;
+	}
+
+	std::map<std::pair<int, int>, uint32_t> vertex_of;
+	std::vector<Vec3f> positions;
+	std::vector<Vec3f> normals;
+	std::vector<uint32_t> indices;
+	indices.reserve(3 * tris_.size());
+	for (auto& tri : tris_) {
+		for (int k = 0; k < 3; k++) {
+			auto key = std::make_pair(tri.vertexIndex[k], unique_normal[tri.vertexNormalsIndex[k]]);
+			auto it = vertex_of.find(key);
+			if (it == vertex_of.end()) {
+				it = vertex_of.emplace(key, static_cast<uint32_t>(positions.size())).first;
+				positions.push_back(verts_[key.first]);
+				normals.push_back(vertNorms_[key.second]);
+			}
+			indices.push_back(it->second);
+		}
+	}
+	return std::make_shared<Mesh>(positions, normals, std::move(indices), std::vector<uint16_t>(tris_.size(), 0),
+		std::vector<std::shared_ptr<Material>>{ mat }, encoding);
+}
+
+void Model::AddToWorld(Hittable_List& world, Vec3f transform, const std::shared_ptr<Material>& mat, int index)
+{
+	AddToWorld(world, Translation(transform), mat, index);
+}
+
+void Model::AddToWorld(Hittable_List& world, const Matrix44f& transform, const std::shared_ptr<Material>& mat, int index)
+{
+	if (tris_.empty()) {
+		return;
 	}
+	world.Add(std::make_shared<Instance>(BLAS(mat, index), transform, mat));
 }
 
 std::ostream& operator<<(std::ostream& os, const Face& f)
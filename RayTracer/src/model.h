@@ -4,6 +4,10 @@
 #include "geometry.h"
 #include "hittable_list.h"
 #include "Triangle.h"
+#include "enum.h"
+
+//	Relative error within which a mesh is swapped for an analytic Sphere or Quad
+constexpr float MODEL_PROXY_TOLERANCE = 1e-3F;
 
 struct Face {
 	std::vector<int> vertexIndex;
@@ -20,10 +24,30 @@ private:
 	std::vector<Vec3f> texCoords_;
 	std::vector<Face> tris_;
 
+	//	Object space tree shared by every instance of the model
+	std::shared_ptr<Hittable> blas;
+	int builder;
+	int layout;		//	LAZY_BVH defers most of the build to the first rays
+	int encoding;	//	COMPRESSED_VERTICES shrinks an indexed Mesh at some precision cost
+
+	//	Analytic stand-in fitted at load time, BLAS returns it in place of the triangles
+	int proxy = NO_PROXY;
+	Point3f proxy_centre;
+	float proxy_radius = 0.F;
+	Point3f proxy_corner;
+	Vec3f proxy_u, proxy_v;
+
 	void LoadModel(std::string filename);
+	std::shared_ptr<Hittable> Indexed_Mesh(const std::shared_ptr<Material>& mat);
+	bool Fit_Sphere(float tolerance);
+	bool Fit_Quad(float tolerance);
+	//	Sum of the face areas and of their winding normals, faces as fans
+	float Surface_Area(Vec3f& winding) const;
 
 public:
-	Model(std::string filename);
+	//	A proxy_tolerance of 0 keeps every mesh as triangles
+	Model(std::string filename, int builder = SAH_BUILDER, int layout = LINEAR_BVH, int encoding = FLOAT_VERTICES,
+		float proxy_tolerance = MODEL_PROXY_TOLERANCE);
 	~Model() = default;
 
 	int nverts();
@@ -36,5 +60,13 @@ public:
 	Face& triangle(int idx);
 	std::vector<Face>& faces();
 
+	//	Builds the tree on first use, mat and index are only baked into its triangles. A
+	//	LINEAR_BVH from the SAH builder is stored as an indexed Mesh instead of Triangle objects.
+	//	The Mesh only has its own binary tree, so every other layout, LAZY_BVH included, still
+	//	builds over one Triangle per face. A model fitted by a proxy is a single Sphere or Quad.
+	std::shared_ptr<Hittable> BLAS(const std::shared_ptr<Material>& mat, int index);
+
+	//	Adds an instance of the model, the mesh itself is only stored once
 	void AddToWorld(Hittable_List& world, Vec3f transform, const std::shared_ptr<Material>& mat, int index);
+	void AddToWorld(Hittable_List& world, const Matrix44f& transform, const std::shared_ptr<Material>& mat, int index);
 };
@@ -0,0 +1,76 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include "common.h"
+
+//	Rays of an 8x8 screen tile traced together, one lane each. Lanes are addressed by bit in a
+//	64 bit mask, so a packet never holds more.
+constexpr int PACKET_SIZE = 64;
+
+//	Structure of arrays rays, t_max of each lane shrinks to its closest hit so far
+struct Ray_Packet {
+	int count = 0;
+	float origin[3][PACKET_SIZE];
+	float dir[3][PACKET_SIZE];
+	float inv_dir[3][PACKET_SIZE];
+	float t_max[PACKET_SIZE];
+
+	inline void Set_Lane(int lane, const Point3f& o, const Vec3f& d, float lane_t_max) {
+		for (int a = 0; a < 3; a++) {
+			origin[a][lane] = o[a];
+			dir[a][lane] = d[a];
+			inv_dir[a][lane] = 1.F / d[a];
+		}
+		t_max[lane] = lane_t_max;
+	}
+
+	inline Ray Lane_Ray(int lane) const {
+		return Ray(Point3f(origin[0][lane], origin[1][lane], origin[2][lane]), Vec3f(dir[0][lane], dir[1][lane], dir[2][lane]));
+	}
+};
+
+inline bool Lane_Active(uint64_t lanes, int lane) {
+	return (lanes >> lane & 1) != 0;
+}
+
+//	Interval of every active lane's origin and inverse direction, so one test can tell that
+//	a box is missed by all of them
+struct Packet_Bounds {
+	float origin_min[3], origin_max[3];
+	float inv_min[3], inv_max[3];
+	bool same_sign[3];		//	axes where the interval test is usable
+	float far_t;			//	largest t_max
+
+	Packet_Bounds(const Ray_Packet& packet, uint64_t active) {
+		for (int a = 0; a < 3; a++) {
+			origin_min[a] = inv_min[a] = static_cast<float>(infinity);
+			origin_max[a] = inv_max[a] = -static_cast<float>(infinity);
+		}
+		far_t = -static_cast<float>(infinity);
+		for (int lane = 0; lane < packet.count; lane++) {
+			if (!Lane_Active(active, lane)) {
+				continue;
+			}
+			for (int a = 0; a < 3; a++) {
+				origin_min[a] = std::min(origin_min[a], packet.origin[a][lane]);
+				origin_max[a] = std::max(origin_max[a], packet.origin[a][lane]);
+				inv_min[a] = std::min(inv_min[a], packet.inv_dir[a][lane]);
+				inv_max[a] = std::max(inv_max[a], packet.inv_dir[a][lane]);
+			}
+			far_t = std::max(far_t, packet.t_max[lane]);
+		}
+		for (int a = 0; a < 3; a++) {
+			same_sign[a] = std::isfinite(inv_min[a]) && std::isfinite(inv_max[a]) && (inv_min[a] > 0.F || inv_max[a] < 0.F);
+		}
+	}
+
+	void Update_Far(const Ray_Packet& packet, uint64_t active) {
+		far_t = -static_cast<float>(infinity);
+		for (int lane = 0; lane < packet.count; lane++) {
+			if (Lane_Active(active, lane)) {
+				far_t = std::max(far_t, packet.t_max[lane]);
+			}
+		}
+	}
+};
@@ -0,0 +1,18 @@
+#include "plane.h"
+
+bool Plane::Hit(const Ray& r, double t_min, double t_max, Hit_Record& rec) const {
+	float t;
+	if (!Intersect(r, t_min, t_max, t)) {
+		return false;
+	}
+	rec.t = t;
+	rec.p = r.At(rec.t);
+	rec.Set_Face_Normal(r, normal);
+	rec.mat_ptr = mat_ptr;
+	return true;
+}
+
+bool Plane::Occluded(const Ray& r, double t_min, double t_max) const {
+	float t;
+	return Intersect(r, t_min, t_max, t);
+}
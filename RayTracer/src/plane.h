@@ -0,0 +1,33 @@
+#pragma once
+
+#include "hittable.h"
+
+//	Infinite two sided plane through point with the given normal. It has no bounding box, so
+//	Hittable_List::Build keeps it out of the tree and tests it on its own.
+class Plane : public Hittable {
+public:
+	Plane() { id = 5; }
+	Plane(Point3f point, Vec3f normal, std::shared_ptr<Material> m, int m_idx)
+		: point(point), normal(normal.normalize()), mat_ptr(m), mat_index(m_idx) { id = 5; }
+
+	virtual bool Hit(const Ray& r, double t_min, double t_max, Hit_Record& rec) const override;
+	virtual bool Bounding_Box(AABB& /*output_box*/) const override { return false; }
+	virtual bool Occluded(const Ray& r, double t_min, double t_max) const override;
+	virtual void Translate(const Vec3f& offset) override { point += offset; }
+
+private:
+	inline bool Intersect(const Ray& r, double t_min, double t_max, float& t) const {
+		const float denom = normal.dotProduct(r.Direction());
+		if (denom == 0.F) {
+			return false;
+		}
+		t = (point - r.Origin()).dotProduct(normal) / denom;
+		return t >= t_min && t <= t_max;
+	}
+
+public:
+	Point3f point;
+	Vec3f normal;
+	std::shared_ptr<Material> mat_ptr;
+	int mat_index;
+};
@@ -0,0 +1,56 @@
+#include "quad.h"
+#include <algorithm>
+
+void Quad::Precompute() {
+	const Vec3f n = u.crossProduct(v);
+	w = n / n.norm();
+	normal = n;
+	normal.normalize();
+	d = normal.dotProduct(corner);
+}
+
+inline bool Quad::Intersect(const Ray& r, double t_min, double t_max, float& t) const {
+	//	Back faces are culled as Triangle culls them, so a wall seen from behind stays open
+	const float denom = normal.dotProduct(r.Direction());
+	if (denom >= 0.F) {
+		return false;
+	}
+	t = (d - normal.dotProduct(r.Origin())) / denom;
+	if (t < t_min || t > t_max) {
+		return false;
+	}
+	const Vec3f planar = r.At(t) - corner;
+	const float alpha = w.dotProduct(planar.crossProduct(v));
+	const float beta = w.dotProduct(u.crossProduct(planar));
+	return alpha >= 0.F && alpha <= 1.F && beta >= 0.F && beta <= 1.F;
+}
+
+bool Quad::Hit(const Ray& r, double t_min, double t_max, Hit_Record& rec) const {
+	float t;
+	if (!Intersect(r, t_min, t_max, t)) {
+		return false;
+	}
+	rec.t = t;
+	rec.p = r.At(rec.t);
+	rec.Set_Face_Normal(r, normal);
+	rec.mat_ptr = mat_ptr;
+	return true;
+}
+
+bool Quad::Occluded(const Ray& r, double t_min, double t_max) const {
+	float t;
+	return Intersect(r, t_min, t_max, t);
+}
+
+bool Quad::Bounding_Box(AABB& output_box) const {
+	const Point3f corners[3] = { corner + u, corner + v, corner + u + v };
+	Point3f min = corner, max = corner;
+	for (const auto& c : corners) {
+		for (int a = 0; a < 3; a++) {
+			min[a] = std::min(min[a], c[a]);
+			max[a] = std::max(max[a], c[a]);
+		}
+	}
+	output_box = AABB(min, max);
+	return true;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "hittable.h"
+
+//	Parallelogram with one corner at corner and edges u and v, only hit from the side u x v faces
+class Quad : public Hittable {
+public:
+	Quad() { id = 6; }
+	Quad(Point3f corner, Vec3f u, Vec3f v, std::shared_ptr<Material> m, int m_idx)
+		: corner(corner), u(u), v(v), mat_ptr(m), mat_index(m_idx) { id = 6; Precompute(); }
+
+	virtual bool Hit(const Ray& r, double t_min, double t_max, Hit_Record& rec) const override;
+	virtual bool Bounding_Box(AABB& output_box) const override;
+	virtual bool Occluded(const Ray& r, double t_min, double t_max) const override;
+	virtual void Translate(const Vec3f& offset) override { corner += offset; Precompute(); }
+
+private:
+	inline bool Intersect(const Ray& r, double t_min, double t_max, float& t) const;
+	void Precompute();
+
+public:
+	Point3f corner;
+	Vec3f u, v;
+	std::shared_ptr<Material> mat_ptr;
+	int mat_index;
+
+private:
+	Vec3f normal;		//	unit u x v
+	Vec3f w;			//	u x v over its squared length, maps a point in the plane to its edge coordinates
+	float d;			//	normal . corner
+};
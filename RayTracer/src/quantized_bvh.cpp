@@ -0,0 +1,267 @@
+#include "quantized_bvh.h"
+#include "wide_bvh.h"
+#include "linear_bvh.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#if defined(QUANTIZED_BVH_SSE)
+#include <immintrin.h>
+#endif
+
+//	2^e built straight from the exponent bits, so decoding is exact
+inline float Exp2(int e) {
+	uint32_t bits = static_cast<uint32_t>(e + 127) << 23;
+	float f;
+	std::memcpy(&f, &bits, sizeof(f));
+	return f;
+}
+
+//	Cell size for one axis, the smallest power of two that fits the extent in 255 steps
+inline int8_t Quantize_Exponent(float extent) {
+	int e = 0;
+	std::frexp(extent / 255.F, &e);
+	return static_cast<int8_t>(std::max(-126, std::min(127, e)));
+}
+
+//	Rounded down for minimums and up for maximums, then stepped until the decoded value,
+//	computed exactly as traversal does, really lies outside the box
+inline uint8_t Quantize_Min(float value, float origin, float scale) {
+	int q = static_cast<int>(std::floor((value - origin) / scale));
+	q = std::max(0, std::min(255, q));
+	while (q > 0 && origin + q * scale > value) {
+		q--;
+	}
+	return static_cast<uint8_t>(q);
+}
+
+inline uint8_t Quantize_Max(float value, float origin, float scale) {
+	int q = static_cast<int>(std::ceil((value - origin) / scale));
+	q = std::max(0, std::min(255, q));
+	while (q < 255 && origin + q * scale < value) {
+		q++;
+	}
+	return static_cast<uint8_t>(q);
+}
+
+inline Quantized_BVH_Node Quantize(const Wide_BVH_Node<4>& wide) {
+	Quantized_BVH_Node node = {};
+
+	AABB parent = Empty_Box();
+	for (int i = 0; i < 4; i++) {
+		if (wide.child[i] == 0 && wide.count[i] == 0) {
+			continue;
+		}
+		node.valid |= 1 << i;
+		parent = Enclosing_Box(parent, AABB(Point3f(wide.min_x[i], wide.min_y[i], wide.min_z[i]),
+			Point3f(wide.max_x[i], wide.max_y[i], wide.max_z[i])));
+	}
+
+	float scale[3];
+	for (int a = 0; a < 3; a++) {
+		node.origin[a] = parent.Min()[a];
+		node.exponent[a] = Quantize_Exponent(parent.Max()[a] - parent.Min()[a]);
+		if (node.origin[a] + 255 * Exp2(node.exponent[a]) < parent.Max()[a]) {
+			node.exponent[a]++;
+		}
+		scale[a] = Exp2(node.exponent[a]);
+	}
+
+	for (int i = 0; i < 4; i++) {
+		node.child[i] = wide.child[i];
+		node.count[i] = wide.count[i];
+		if (!(node.valid & (1 << i))) {
+			continue;
+		}
+		node.q_min_x[i] = Quantize_Min(wide.min_x[i], node.origin[0], scale[0]);
+		node.q_min_y[i] = Quantize_Min(wide.min_y[i], node.origin[1], scale[1]);
+		node.q_min_z[i] = Quantize_Min(wide.min_z[i], node.origin[2], scale[2]);
+		node.q_max_x[i] = Quantize_Max(wide.max_x[i], node.origin[0], scale[0]);
+		node.q_max_y[i] = Quantize_Max(wide.max_y[i], node.origin[1], scale[1]);
+		node.q_max_z[i] = Quantize_Max(wide.max_z[i], node.origin[2], scale[2]);
+	}
+	return node;
+}
+
+//	Decodes the four child boxes and slab tests them, same contract as Intersect_Children
+inline int Intersect_Quantized(const Quantized_BVH_Node& node, const float origin[3], const float inv_dir[3], const bool dir_is_neg[3],
+	float t_min, float t_max, float t_near[4]) {
+	const uint8_t* near_x = dir_is_neg[0] ? node.q_max_x : node.q_min_x;
+	const uint8_t* near_y = dir_is_neg[1] ? node.q_max_y : node.q_min_y;
+	const uint8_t* near_z = dir_is_neg[2] ? node.q_max_z : node.q_min_z;
+	const uint8_t* far_x = dir_is_neg[0] ? node.q_min_x : node.q_max_x;
+	const uint8_t* far_y = dir_is_neg[1] ? node.q_min_y : node.q_max_y;
+	const uint8_t* far_z = dir_is_neg[2] ? node.q_min_z : node.q_max_z;
+	const float sx = Exp2(node.exponent[0]), sy = Exp2(node.exponent[1]), sz = Exp2(node.exponent[2]);
+
+#if defined(QUANTIZED_BVH_SSE)
+	auto decode = [](const uint8_t* q, float base, float scale) {
+		int32_t packed;
+		std::memcpy(&packed, q, sizeof(packed));
+		__m128 v = _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(packed)));
+		return _mm_add_ps(_mm_set1_ps(base), _mm_mul_ps(v, _mm_set1_ps(scale)));
+	};
+	const __m128 ox = _mm_set1_ps(origin[0]), oy = _mm_set1_ps(origin[1]), oz = _mm_set1_ps(origin[2]);
+	const __m128 ix = _mm_set1_ps(inv_dir[0]), iy = _mm_set1_ps(inv_dir[1]), iz = _mm_set1_ps(inv_dir[2]);
+
+	__m128 t0x = _mm_mul_ps(_mm_sub_ps(decode(near_x, node.origin[0], sx), ox), ix);
+	__m128 t0y = _mm_mul_ps(_mm_sub_ps(decode(near_y, node.origin[1], sy), oy), iy);
+	__m128 t0z = _mm_mul_ps(_mm_sub_ps(decode(near_z, node.origin[2], sz), oz), iz);
+	__m128 t1x = _mm_mul_ps(_mm_sub_ps(decode(far_x, node.origin[0], sx), ox), ix);
+	__m128 t1y = _mm_mul_ps(_mm_sub_ps(decode(far_y, node.origin[1], sy), oy), iy);
+	__m128 t1z = _mm_mul_ps(_mm_sub_ps(decode(far_z, node.origin[2], sz), oz), iz);
+
+	__m128 t0 = _mm_max_ps(_mm_max_ps(t0x, t0y), _mm_max_ps(t0z, _mm_set1_ps(t_min)));
+	__m128 t1 = _mm_min_ps(_mm_min_ps(t1x, t1y), _mm_min_ps(t1z, _mm_set1_ps(t_max)));
+	_mm_storeu_ps(t_near, t0);
+	return _mm_movemask_ps(_mm_cmple_ps(t0, t1)) & node.valid;
+#else
+	int mask = 0;
+	for (int i = 0; i < 4; i++) {
+		float t0 = t_min;
+		float t1 = t_max;
+		float tx0 = (node.origin[0] + near_x[i] * sx - origin[0]) * inv_dir[0], tx1 = (node.origin[0] + far_x[i] * sx - origin[0]) * inv_dir[0];
+		float ty0 = (node.origin[1] + near_y[i] * sy - origin[1]) * inv_dir[1], ty1 = (node.origin[1] + far_y[i] * sy - origin[1]) * inv_dir[1];
+		float tz0 = (node.origin[2] + near_z[i] * sz - origin[2]) * inv_dir[2], tz1 = (node.origin[2] + far_z[i] * sz - origin[2]) * inv_dir[2];
+		t0 = tx0 > t0 ? tx0 : t0;
+		t0 = ty0 > t0 ? ty0 : t0;
+		t0 = tz0 > t0 ? tz0 : t0;
+		t1 = tx1 < t1 ? tx1 : t1;
+		t1 = ty1 < t1 ? ty1 : t1;
+		t1 = tz1 < t1 ? tz1 : t1;
+		t_near[i] = t0;
+		mask |= (t0 <= t1) << i;
+	}
+	return mask & node.valid;
+#endif
+}
+
+Quantized_BVH::Quantized_BVH(std::shared_ptr<Hittable> root, int order) {
+	//	Same topology and node order as BVH4, only the boxes are re-encoded
+	BVH4 wide(root, order);
+	bounds = wide.bounds;
+	primitives = std::move(wide.primitives);
+	nodes.reserve(wide.nodes.size());
+	for (const auto& node : wide.nodes) {
+		nodes.push_back(Quantize(node));
+	}
+
+	size_t bytes = nodes.size() * sizeof(Quantized_BVH_Node);
+	size_t wide_bytes = wide.nodes.size() * sizeof(Wide_BVH_Node<4>);
+	std::cerr << "Quantized BVH: " << nodes.size() << " nodes, " << bytes / 1024 << " KB against "
+		<< wide_bytes / 1024 << " KB for BVH4\n";
+}
+
+bool Quantized_BVH::Hit(const Ray& r, double t_min, double t_max, Hit_Record& rec) const {
+	const Point3f o = r.Origin();
+	const Vec3f d = r.Direction();
+	const float origin[3] = { o.x, o.y, o.z };
+	const float inv_dir[3] = { 1.F / d.x, 1.F / d.y, 1.F / d.z };
+	const bool dir_is_neg[3] = { inv_dir[0] < 0, inv_dir[1] < 0, inv_dir[2] < 0 };
+
+	struct Stack_Entry {
+		int node;
+		float t;
+	};
+	Stack_Entry to_visit[BVH_STACK_SIZE * 4];
+	int to_visit_offset = 0;
+	to_visit[to_visit_offset++] = { 0, static_cast<float>(t_min) };
+
+	bool hit_anything = false;
+	double closest_so_far = t_max;
+
+	while (to_visit_offset > 0) {
+		const Stack_Entry entry = to_visit[--to_visit_offset];
+		if (entry.t > closest_so_far) {
+			continue;
+		}
+		const Quantized_BVH_Node& node = nodes[entry.node];
+
+		float t_near[4];
+		int mask = Intersect_Quantized(node, origin, inv_dir, dir_is_neg, static_cast<float>(t_min), static_cast<float>(closest_so_far), t_near);
+
+		//	Same ordering as Wide_BVH::Hit
+		int interior[4];
+		int leaves[4];
+		int n_interior = 0;
+		int n_leaves = 0;
+		for (int i = 0; i < 4; i++) {
+			if (!(mask & (1 << i))) {
+				continue;
+			}
+			if (node.child[i] >= 0) {
+				int j = n_interior++;
+				while (j > 0 && t_near[interior[j - 1]] < t_near[i]) {
+					interior[j] = interior[j - 1];
+					j--;
+				}
+				interior[j] = i;
+				continue;
+			}
+			int j = n_leaves++;
+			while (j > 0 && t_near[leaves[j - 1]] > t_near[i]) {
+				leaves[j] = leaves[j - 1];
+				j--;
+			}
+			leaves[j] = i;
+		}
+		for (int i = 0; i < n_leaves; i++) {
+			if (t_near[leaves[i]] > closest_so_far) {
+				break;
+			}
+			int first = ~node.child[leaves[i]];
+			for (int p = first; p < first + node.count[leaves[i]]; p++) {
+				if (primitives[p]->Hit(r, t_min, closest_so_far, rec)) {
+					hit_anything = true;
+					closest_so_far = rec.t;
+				}
+			}
+		}
+		for (int i = 0; i < n_interior; i++) {
+			if (t_near[interior[i]] <= closest_so_far) {
+				to_visit[to_visit_offset++] = { node.child[interior[i]], t_near[interior[i]] };
+			}
+		}
+	}
+	return hit_anything;
+}
+
+bool Quantized_BVH::Occluded(const Ray& r, double t_min, double t_max) const {
+	const Point3f o = r.Origin();
+	const Vec3f d = r.Direction();
+	const float origin[3] = { o.x, o.y, o.z };
+	const float inv_dir[3] = { 1.F / d.x, 1.F / d.y, 1.F / d.z };
+	const bool dir_is_neg[3] = { inv_dir[0] < 0, inv_dir[1] < 0, inv_dir[2] < 0 };
+
+	int to_visit[BVH_STACK_SIZE * 4];
+	int to_visit_offset = 0;
+	to_visit[to_visit_offset++] = 0;
+
+	while (to_visit_offset > 0) {
+		const Quantized_BVH_Node& node = nodes[to_visit[--to_visit_offset]];
+
+		float t_near[4];
+		int mask = Intersect_Quantized(node, origin, inv_dir, dir_is_neg, static_cast<float>(t_min), static_cast<float>(t_max), t_near);
+		for (int i = 0; i < 4; i++) {
+			if (!(mask & (1 << i))) {
+				continue;
+			}
+			if (node.child[i] >= 0) {
+				to_visit[to_visit_offset++] = node.child[i];
+				continue;
+			}
+			int first = ~node.child[i];
+			for (int p = first; p < first + node.count[i]; p++) {
+				if (primitives[p]->Occluded(r, t_min, t_max)) {
+					return true;
+				}
+			}
+		}
+	}
+	return false;
+}
+
+bool Quantized_BVH::Bounding_Box(AABB& output_box) const {
+	output_box = bounds;
+	return true;
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "hittable.h"
+#include "enum.h"
+
+#if defined(__SSE4_1__) || defined(__AVX__)
+#define QUANTIZED_BVH_SSE
+#endif
+
+//	4 wide node in one 64 byte cache line. Child boxes are stored as 8 bit offsets on a grid
+//	starting at origin with a power of two cell size per axis, rounded outwards so the decoded
+//	box always contains the real one. Layout otherwise matches Wide_BVH_Node<4>.
+struct Quantized_BVH_Node {
+	float origin[3];
+	int8_t exponent[3];
+	uint8_t valid;			//	bit per used lane
+	uint8_t q_min_x[4], q_min_y[4], q_min_z[4];
+	uint8_t q_max_x[4], q_max_y[4], q_max_z[4];
+	int child[4];
+	uint16_t count[4];
+};
+
+static_assert(sizeof(Quantized_BVH_Node) == 64, "Quantized_BVH_Node should fill one cache line");
+
+class Quantized_BVH : public Hittable {
+public:
+	Quantized_BVH(std::shared_ptr<Hittable> root, int order = DEPTH_FIRST_ORDER);
+
+	virtual bool Hit(const Ray& r, double t_min, double t_max, Hit_Record& rec) const override;
+	virtual bool Bounding_Box(AABB& output_box) const override;
+	virtual bool Occluded(const Ray& r, double t_min, double t_max) const override;
+
+public:
+	std::vector<Quantized_BVH_Node> nodes;
+	std::vector<std::shared_ptr<Hittable>> primitives;
+	AABB bounds;
+};
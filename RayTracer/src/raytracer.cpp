@@ -1,20 +1,19 @@
 ﻿#include "ray.h"
 #include "common.h"
-#include "fileparser.h"
 #include "timer.h"
 #include "enum.h"
 #include "scene.h"
 #include "renderer.h"
 #include "tree.h"
+#include "benchmark.h"
+#include "bvh_stats.h"
 #if defined(_WIN32) || defined(_WIN64)
 #include <SDL.h>
 #define M_PI 3.14159265359
-std::string file = "win-scene";
 const char* renderFile = "./res/output/render-win.tga";
 #endif
 #if defined(__unix__) || defined(__linux__)
 #include <SDL2/SDL.h>
-std::string file = "linux-scene";
 const char* renderFile = "./res/output/render-linux.tga";
 #endif
 #include <fstream>
@@ -24,6 +23,10 @@ const char* renderFile = "./res/output/render-linux.tga";
 //	Remove/Add this define for different scenes
 #define BALL
 
+//	Add this define to print rays/sec and cache misses for each BVH layout and node order, and
+//	write the SAH tree statistics to res/output/bvh-stats.json
+//#define BENCHMARK
+
 SDL_Window* window;
 SDL_Renderer* renderer;
 SDL_Surface* screen;
@@ -100,26 +103,11 @@ int main(int argc, char** argv)
 	Hittable_List world = Ball_Scene(mats);
 #else
 	std::vector<std::shared_ptr<Material>> mats;
-	Hittable_List world;
-	std::ifstream bvhfile("./res/binary/" + file + ".bvh", std::ifstream::binary);
-	std::ifstream matfile("./res/binary/" + file + ".mtls", std::ifstream::binary);
-	if (!bvhfile || !matfile) {
-		std::vector<std::shared_ptr<Hittable>> nodes;
-		std::vector<std::shared_ptr<Material>> mats;
-		world = My_Scene(mats);
-		Traverse_Tree(world.objects.front(), nodes);
-		WriteNode(nodes, file + ".bvh");
-		WriteMaterials(mats, file + ".mtls");
-	}
-	else {
-		std::vector<Material*> mtls = ReadMaterials(file + ".mtls");
-		std::vector<Hittable*> nodes = ReadNode(file + ".bvh");
-		auto materials = Create_Materials(mtls);
-		std::cout << "Creating Tree...\n";
-		auto root = Create_Tree(nodes, materials);
-		std::cout << "Tree Created...\n";
-		world.Add(root);
-	}
+	Hittable_List world = My_Scene(mats);
+#endif
+#ifdef BENCHMARK
+	Benchmark_Layouts(world, cam);
+	Write_BVH_Stats(Compute_BVH_Stats(Build_Tree(world, SAH_BUILDER)), "./res/output/bvh-stats.json");
 #endif
 
 	SDL_Event e;
@@ -133,6 +121,8 @@ int main(int argc, char** argv)
 		// Use this to render higher quality images a little faster. 
 		// NOTE: This method does not update the current progress to screen unlike interactive. 
 		//StaticRender(screen, image_width, image_height, std::ref(cam), std::ref(world), std::ref(totalColour), spp, max_depth, 50);
+		// Same, but breadth first: each bounce of every path is sorted and traced in bulk. Faster at high spp.
+		//WavefrontRender(screen, image_width, image_height, std::ref(cam), std::ref(world), std::ref(totalColour), spp, max_depth, 50);
 
 		SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, screen);
 		if (texture == nullptr) {
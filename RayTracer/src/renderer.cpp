@@ -43,14 +43,33 @@ Colour Ray_Colour(const Ray& r, const Colour& background, const Hittable& world,
 	}
 	if (!world.Hit(r, 0.001, infinity, rec)) {
 		return background;
-	}	
-	Ray scattered;
-	Colour attentuation;
-	Colour emitted = rec.mat_ptr->Emitted();
-	if (!rec.mat_ptr->Scatter(r, rec, attentuation, scattered)) {
-		return emitted;
 	}
-	return emitted + attentuation * Ray_Colour(scattered, background, world, depth - 1);
+	return Hit_Colour(r, rec, background, world, depth);
+}
+
+//	Follows the path bounce by bounce carrying its throughput, rather than recursing and
+//	multiplying the attenuations back up on the way out
+Colour Hit_Colour(const Ray& r, const Hit_Record& first_hit, const Colour& background, const Hittable& world, int depth) {
+	Colour radiance(0, 0, 0);
+	Colour throughput(1, 1, 1);
+	Ray ray = r;
+	Hit_Record rec = first_hit;
+	for (int bounce = 1; ; bounce++) {
+		radiance += throughput * rec.mat_ptr->Emitted();
+		Ray scattered;
+		Colour attentuation;
+		if (bounce >= depth || !rec.mat_ptr->Scatter(ray, rec, attentuation, scattered)) {
+			return radiance;
+		}
+		throughput = throughput * attentuation;
+		if (!Russian_Roulette(throughput, bounce)) {
+			return radiance;
+		}
+		ray = scattered;
+		if (!world.Hit(ray, 0.001, infinity, rec)) {
+			return radiance + throughput * background;
+		}
+	}
 }
 
 void Image_Write(ColourArr& image, int spp)
@@ -76,20 +95,17 @@ void Image_Write(ColourArr& image, int spp)
 	stbi_write_tga(renderFile, WIDTH, HEIGHT, 3, img1920x1080_rgb);
 }
 
-void RenderPixel(SDL_Surface* screen, const int image_width, const int image_height,
-	Camera& cam, Hittable_List& world, ColourArr& colours, int x, int y, int spp, int max_depth)
+static Colour Background(const Ray& ray)
 {
-	Colour background(0, 0, 0);
-	Colour pix_col = colours[x][y];
-
-	auto u = double(x + Random_Double()) / (image_width - 1);
-	auto v = double(y + Random_Double()) / (image_height - 1);
-	Ray ray = cam.Get_Ray(u, v);
 	Vec3f unit_direction = ray.Direction().normalize();
 	auto t = 0.5 * (unit_direction.y + 1.0);
-	background = (1.0 - t) * Colour(1.0, 1.0, 1.0) + t * Colour(0.5, 0.7, 1.0) * 255;
-	pix_col = pix_col + Ray_Colour(ray, background, world, max_depth);
+	return (1.0 - t) * Colour(1.0, 1.0, 1.0) + t * Colour(0.5, 0.7, 1.0) * 255;
+}
 
+//	Adds a sample to the pixel's running sum and shows the new average
+static void Accumulate_Pixel(SDL_Surface* screen, ColourArr& colours, int x, int y, int spp, const Colour& sample)
+{
+	Colour pix_col = colours[x][y] + sample;
 	colours[x][y] = pix_col;
 
 	pix_col /= 255.f * spp;
@@ -101,15 +117,56 @@ void RenderPixel(SDL_Surface* screen, const int image_width, const int image_hei
 	putpixel(screen, x, y, colour);
 }
 
+void RenderPixel(SDL_Surface* screen, const int image_width, const int image_height,
+	Camera& cam, Hittable_List& world, ColourArr& colours, int x, int y, int spp, int max_depth)
+{
+	auto u = double(x + Random_Double()) / (image_width - 1);
+	auto v = double(y + Random_Double()) / (image_height - 1);
+	Ray ray = cam.Get_Ray(u, v);
+	Accumulate_Pixel(screen, colours, x, y, spp, Ray_Colour(ray, Background(ray), world, max_depth));
+}
+
+void RenderTile(SDL_Surface* screen, const int image_width, const int image_height,
+	Camera& cam, Hittable_List& world, ColourArr& colours, int x, int y, int spp, int max_depth)
+{
+	const int width = std::min(RENDER_TILE, image_width - x);
+	const int height = std::min(RENDER_TILE, image_height - y);
+	if (!world.Packet_Traversal()) {
+		for (int ty = y; ty < y + height; ty++) {
+			for (int tx = x; tx < x + width; tx++) {
+				RenderPixel(screen, image_width, image_height, cam, world, colours, tx, ty, spp, max_depth);
+			}
+		}
+		return;
+	}
+	Ray_Packet packet;
+	const uint64_t active = cam.Get_Packet(x, y, width, height, image_width, image_height, packet);
+	Hit_Record recs[PACKET_SIZE];
+	const uint64_t hits = max_depth > 0 ? world.Hit_Packet(packet, active, 0.001, recs) : 0;
+
+	for (int lane = 0; lane < packet.count; lane++) {
+		const Ray ray = packet.Lane_Ray(lane);
+		const Colour background = Background(ray);
+		Colour sample(0, 0, 0);
+		if (Lane_Active(hits, lane)) {
+			sample = Hit_Colour(ray, recs[lane], background, world, max_depth);
+		}
+		else if (max_depth > 0) {
+			sample = background;
+		}
+		Accumulate_Pixel(screen, colours, x + lane % width, y + lane / width, spp, sample);
+	}
+}
+
 void InteractiveRender(SDL_Surface* screen, const int image_width, const int image_height,
 	Camera& cam, Hittable_List& world, ColourArr& colours, int& spp, int max_depth) {
 		{
 			Timer t("Frame render time: ");
 			ThreadPool pool(std::thread::hardware_concurrency());
-			for (int x = screen->w- 1; x >= 0; x--) {
-				for (int y = screen->h - 1; y >= 0; y--)
+			for (int x = 0; x < screen->w; x += RENDER_TILE) {
+				for (int y = 0; y < screen->h; y += RENDER_TILE)
 				{
-					pool.Enqueue(std::bind(RenderPixel, screen, image_width, image_height, std::ref(cam), std::ref(world), std::ref(colours), x, y, spp, max_depth));
+					pool.Enqueue(std::bind(RenderTile, screen, image_width, image_height, std::ref(cam), std::ref(world), std::ref(colours), x, y, spp, max_depth));
 				}
 			}
 			spp++;
@@ -123,14 +180,48 @@ void StaticRender(SDL_Surface* screen, const int image_width, const int image_he
 			for (int i = 0; i < renderQuality; i++)
 			{
 				ThreadPool pool(std::thread::hardware_concurrency());
-				for (int x = screen->w - 1; x >= 0; x--) {
-					for (int y = screen->h - 1; y >= 0; y--)
+				for (int x = 0; x < screen->w; x += RENDER_TILE) {
+					for (int y = 0; y < screen->h; y += RENDER_TILE)
 					{
-						pool.Enqueue(std::bind(RenderPixel, screen, image_width, image_height, std::ref(cam), std::ref(world), std::ref(colours), x, y, spp, max_depth));
+						pool.Enqueue(std::bind(RenderTile, screen, image_width, image_height, std::ref(cam), std::ref(world), std::ref(colours), x, y, spp, max_depth));
+					}
+				}
+				spp++;
+			}
+			Image_Write(colours, spp);
+		}
+}
+
+void WavefrontRender(SDL_Surface* screen, const int image_width, const int image_height,
+	Camera& cam, Hittable_List& world, ColourArr& colours, int& spp, int max_depth, int renderQuality) {
+		{
+			Timer t("Scene render time: ");
+			Wavefront_Integrator integrator(world, max_depth);
+			std::vector<std::pair<int, int>> pixels;
+			for (int x = 0; x < screen->w; x += RENDER_TILE) {
+				for (int y = 0; y < screen->h; y += RENDER_TILE) {
+					for (int ty = y; ty < std::min(y + RENDER_TILE, screen->h); ty++) {
+						for (int tx = x; tx < std::min(x + RENDER_TILE, screen->w); tx++) {
+							pixels.emplace_back(tx, ty);
+						}
 					}
 				}
+			}
+			for (int i = 0; i < renderQuality; i++)
+			{
+				integrator.Clear();
+				for (const auto& pixel : pixels) {
+					auto u = double(pixel.first + Random_Double()) / (image_width - 1);
+					auto v = double(pixel.second + Random_Double()) / (image_height - 1);
+					Ray ray = cam.Get_Ray(u, v);
+					integrator.Add_Path(ray, Background(ray));
+				}
+				integrator.Trace();
+				for (size_t p = 0; p < pixels.size(); p++) {
+					Accumulate_Pixel(screen, colours, pixels[p].first, pixels[p].second, spp, integrator.radiance[p]);
+				}
 				spp++;
 			}
 			Image_Write(colours, spp);
 		}
-}
\ No newline at end of file
+}
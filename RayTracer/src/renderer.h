@@ -9,6 +9,7 @@
 #include "timer.h"
 #include "threadpool.h"
 #include "material.h"
+#include "wavefront.h"
 #if defined(_WIN32) || defined(_WIN64)
 #include <SDL.h>
 #define M_PI 3.14159265359
@@ -22,17 +23,32 @@ typedef std::vector<std::vector<Colour>> ColourArr;
 constexpr int WIDTH = 1280;
 constexpr int HEIGHT = 720;
 
+//	Render tasks cover RENDER_TILE x RENDER_TILE pixels whose primary rays go out as one packet
+constexpr int RENDER_TILE = 8;
+static_assert(RENDER_TILE * RENDER_TILE <= PACKET_SIZE, "a tile must fit in one ray packet");
+
 void putpixel(SDL_Surface* surface, int x, int y, Uint32 pixel);
 
 Colour Ray_Colour(const Ray& r, const Colour& background, const Hittable& world, int depth);
+//	Ray_Colour once the ray is known to hit first_hit
+Colour Hit_Colour(const Ray& r, const Hit_Record& first_hit, const Colour& background, const Hittable& world, int depth);
 
 void Image_Write(ColourArr& image, int spp);
 
 void RenderPixel(SDL_Surface* screen, const int image_width, const int image_height,
 	Camera& cam, Hittable_List& world, ColourArr& colours, int x, int y, int spp, int max_depth);
 
+//	Traces the primary rays of the tile at (x, y) as one packet, then shades each hit alone.
+//	A world without a shared packet traversal is rendered a pixel at a time instead.
+void RenderTile(SDL_Surface* screen, const int image_width, const int image_height,
+	Camera& cam, Hittable_List& world, ColourArr& colours, int x, int y, int spp, int max_depth);
+
 void InteractiveRender(SDL_Surface* screen, const int image_width, const int image_height,
 	Camera& cam, Hittable_List& world, ColourArr& colours, int& spp, int max_depth);
 
 void StaticRender(SDL_Surface* screen, const int image_width, const int image_height,
+	Camera& cam, Hittable_List& world, ColourArr& colours, int& spp, int max_depth, int quality);
+
+//	StaticRender through the Wavefront_Integrator, one sample of every pixel per pass
+void WavefrontRender(SDL_Surface* screen, const int image_width, const int image_height,
 	Camera& cam, Hittable_List& world, ColourArr& colours, int& spp, int max_depth, int quality);
\ No newline at end of file
@@ -0,0 +1,252 @@
+#include "sbvh.h"
+#include "Triangle.h"
+#include "enum.h"
+#include "timer.h"
+#include <atomic>
+#include <future>
+
+constexpr int SPATIAL_BINS = 32;
+constexpr float OVERLAP_ALPHA = 1e-5F;
+constexpr int SPATIAL_MAX_DEPTH = 48;
+constexpr size_t SBVH_PARALLEL_SPAN = 4096;
+
+inline AABB Intersect_Box(const AABB& a, const AABB& b) {
+	Point3f small(std::fmax(a.minimum.x, b.minimum.x), std::fmax(a.minimum.y, b.minimum.y), std::fmax(a.minimum.z, b.minimum.z));
+	Point3f big(std::fmin(a.maximum.x, b.maximum.x), std::fmin(a.maximum.y, b.maximum.y), std::fmin(a.maximum.z, b.maximum.z));
+	if (small.x > big.x || small.y > big.y || small.z > big.z) {
+		return Empty_Box();
+	}
+	return { small, big };
+}
+
+struct Spatial_Split {
+	int axis;
+	float position;
+	float cost;
+};
+
+struct SBVH_Builder {
+	const std::vector<std::shared_ptr<Hittable>>& objects;
+	float root_area;
+	std::atomic<long long> budget;
+
+	AABB Clip(const BVH_Primitive& ref, int axis, float low, float high) const;
+	Spatial_Split Find_Spatial_Split(const std::vector<BVH_Primitive>& refs, const AABB& node_box) const;
+	bool Split_Spatial(const std::vector<BVH_Primitive>& refs, const Spatial_Split& split,
+		std::vector<BVH_Primitive>& left, std::vector<BVH_Primitive>& right);
+	std::shared_ptr<Hittable> Build(std::vector<BVH_Primitive>& refs, int depth, int parallel_depth);
+};
+
+//	Bounds of the part of a reference inside the slab [low, high] on axis. Triangles are clipped
+//	exactly, anything else falls back to clipping its box.
+AABB SBVH_Builder::Clip(const BVH_Primitive& ref, int axis, float low, float high) const {
+	AABB box = ref.box;
+	box.minimum[axis] = std::fmax(box.minimum[axis], low);
+	box.maximum[axis] = std::fmin(box.maximum[axis], high);
+	if (box.minimum[axis] > box.maximum[axis]) {
+		return Empty_Box();
+	}
+
+	const Hittable* object = objects[ref.index].get();
+	if (object->id != TRIANGLE) {
+		return box;
+	}
+
+	const Triangle* tri = static_cast<const Triangle*>(object);
+	const Point3f v[3] = { tri->v0, tri->v1, tri->v2 };
+	AABB clipped = Empty_Box();
+	for (int i = 0; i < 3; i++) {
+		const Point3f& p = v[i];
+		const Point3f& q = v[(i + 1) % 3];
+		if (p[axis] >= low && p[axis] <= high) {
+			clipped = Enclosing_Box(clipped, AABB(p, p));
+		}
+		for (float plane : { low, high }) {
+			if ((p[axis] < plane && q[axis] > plane) || (p[axis] > plane && q[axis] < plane)) {
+				Point3f hit = p + (q - p) * ((plane - p[axis]) / (q[axis] - p[axis]));
+				hit[axis] = plane;
+				clipped = Enclosing_Box(clipped, AABB(hit, hit));
+			}
+		}
+	}
+	return Intersect_Box(box, clipped);
+}
+
+Spatial_Split SBVH_Builder::Find_Spatial_Split(const std::vector<BVH_Primitive>& refs, const AABB& node_box) const {
+	Spatial_Split best = { -1, 0.F, std::numeric_limits<float>::max() };
+
+	for (int a = 0; a < 3; a++) {
+		float low = node_box.Min()[a];
+		float extent = node_box.Max()[a] - low;
+		if (extent <= 0) {
+			continue;
+		}
+		float width = extent / SPATIAL_BINS;
+		float scale = SPATIAL_BINS / extent;
+
+		AABB bounds[SPATIAL_BINS];
+		int entries[SPATIAL_BINS] = {};
+		int exits[SPATIAL_BINS] = {};
+		std::fill(bounds, bounds + SPATIAL_BINS, Empty_Box());
+
+		for (const auto& ref : refs) {
+			int first = std::min(SPATIAL_BINS - 1, std::max(0, static_cast<int>((ref.box.Min()[a] - low) * scale)));
+			int last = std::min(SPATIAL_BINS - 1, std::max(first, static_cast<int>((ref.box.Max()[a] - low) * scale)));
+			for (int b = first; b <= last; b++) {
+				bounds[b] = Enclosing_Box(bounds[b], Clip(ref, a, low + b * width, low + (b + 1) * width));
+			}
+			entries[first]++;
+			exits[last]++;
+		}
+
+		AABB right_box[SPATIAL_BINS];
+		int right_count[SPATIAL_BINS];
+		AABB sweep = Empty_Box();
+		int count = 0;
+		for (int b = SPATIAL_BINS - 1; b > 0; b--) {
+			sweep = Enclosing_Box(sweep, bounds[b]);
+			count += exits[b];
+			right_box[b] = sweep;
+			right_count[b] = count;
+		}
+
+		sweep = Empty_Box();
+		count = 0;
+		for (int b = 0; b < SPATIAL_BINS - 1; b++) {
+			sweep = Enclosing_Box(sweep, bounds[b]);
+			count += entries[b];
+			if (count == 0 || right_count[b + 1] == 0) {
+				continue;
+			}
+			float cost = count * sweep.Surface_Area() + right_count[b + 1] * right_box[b + 1].Surface_Area();
+			if (cost < best.cost) {
+				best = { a, low + (b + 1) * width, cost };
+			}
+		}
+	}
+	return best;
+}
+
+//	Straddling references are duplicated unless moving them whole to one side is cheaper
+//	(reference unsplitting) or the duplication budget has run out.
+bool SBVH_Builder::Split_Spatial(const std::vector<BVH_Primitive>& refs, const Spatial_Split& split,
+	std::vector<BVH_Primitive>& left, std::vector<BVH_Primitive>& right) {
+	const int axis = split.axis;
+	const float big = std::numeric_limits<float>::max();
+	AABB left_box = Empty_Box();
+	AABB right_box = Empty_Box();
+	std::vector<const BVH_Primitive*> straddling;
+
+	for (const auto& ref : refs) {
+		if (ref.box.Max()[axis] <= split.position) {
+			left.push_back(ref);
+			left_box = Enclosing_Box(left_box, ref.box);
+		}
+		else if (ref.box.Min()[axis] >= split.position) {
+			right.push_back(ref);
+			right_box = Enclosing_Box(right_box, ref.box);
+		}
+		else {
+			straddling.push_back(&ref);
+		}
+	}
+
+	for (const BVH_Primitive* ref : straddling) {
+		BVH_Primitive left_ref = *ref;
+		BVH_Primitive right_ref = *ref;
+		left_ref.box = Clip(*ref, axis, -big, split.position);
+		right_ref.box = Clip(*ref, axis, split.position, big);
+		left_ref.centroid = left_ref.box.Centroid();
+		right_ref.centroid = right_ref.box.Centroid();
+
+		float n_left = static_cast<float>(left.size());
+		float n_right = static_cast<float>(right.size());
+		float cost_split = Enclosing_Box(left_box, left_ref.box).Surface_Area() * (n_left + 1) + Enclosing_Box(right_box, right_ref.box).Surface_Area() * (n_right + 1);
+		float cost_left = Enclosing_Box(left_box, ref->box).Surface_Area() * (n_left + 1) + right_box.Surface_Area() * n_right;
+		float cost_right = left_box.Surface_Area() * n_left + Enclosing_Box(right_box, ref->box).Surface_Area() * (n_right + 1);
+
+		bool can_split = cost_split < std::min(cost_left, cost_right) && budget.fetch_sub(1) > 0;
+		if (can_split) {
+			left.push_back(left_ref);
+			right.push_back(right_ref);
+			left_box = Enclosing_Box(left_box, left_ref.box);
+			right_box = Enclosing_Box(right_box, right_ref.box);
+		}
+		else if (cost_left <= cost_right) {
+			left.push_back(*ref);
+			left_box = Enclosing_Box(left_box, ref->box);
+		}
+		else {
+			right.push_back(*ref);
+			right_box = Enclosing_Box(right_box, ref->box);
+		}
+	}
+	return !left.empty() && !right.empty();
+}
+
+std::shared_ptr<Hittable> SBVH_Builder::Build(std::vector<BVH_Primitive>& refs, int depth, int parallel_depth) {
+	if (refs.size() == 1) {
+		return objects[refs.front().index];
+	}
+
+	AABB node_box = Empty_Box();
+	for (const auto& ref : refs) {
+		node_box = Enclosing_Box(node_box, ref.box);
+	}
+
+	std::vector<BVH_Primitive> left, right;
+	SAH_Split object = Find_SAH_Split(refs, 0, refs.size());
+
+	bool spatial = false;
+	if (depth < SPATIAL_MAX_DEPTH && budget.load() > 0) {
+		float overlap = object.bin == -1 ? node_box.Surface_Area() : Intersect_Box(object.left_box, object.right_box).Surface_Area();
+		if (overlap > OVERLAP_ALPHA * root_area) {
+			Spatial_Split split = Find_Spatial_Split(refs, node_box);
+			if (split.axis != -1 && split.cost < object.cost) {
+				spatial = Split_Spatial(refs, split, left, right);
+			}
+		}
+	}
+	if (!spatial) {
+		left.clear();
+		right.clear();
+		size_t mid = Partition_SAH(refs, 0, refs.size(), object);
+		left.assign(begin(refs), begin(refs) + mid);
+		right.assign(begin(refs) + mid, end(refs));
+	}
+	refs.clear();
+	refs.shrink_to_fit();
+
+	auto node = std::make_shared<BVH_Node>();
+	if (parallel_depth > 0 && left.size() + right.size() > SBVH_PARALLEL_SPAN) {
+		auto future = std::async(std::launch::async, &SBVH_Builder::Build, this, std::ref(left), depth + 1, parallel_depth - 1);
+		node->right = Build(right, depth + 1, parallel_depth - 1);
+		node->left = future.get();
+	}
+	else {
+		node->left = Build(left, depth + 1, 0);
+		node->right = Build(right, depth + 1, 0);
+	}
+
+	//	Bounds come from the clipped references so they are tighter than the children's own boxes
+	node->box = Surrounding_Box(node_box, node_box);
+	return node;
+}
+
+std::shared_ptr<Hittable> Build_SBVH(const Hittable_List& list, float duplication_budget) {
+	Timer t("SBVH build time: ");
+	const auto& objects = list.objects;
+	if (objects.size() == 1) {
+		return std::make_shared<BVH_Node>(objects, 0, 1);
+	}
+
+	std::vector<BVH_Primitive> refs = Gather_Primitives(objects, 0, objects.size());
+	AABB root_box = Empty_Box();
+	for (const auto& ref : refs) {
+		root_box = Enclosing_Box(root_box, ref.box);
+	}
+
+	SBVH_Builder builder = { objects, root_box.Surface_Area(), {} };
+	builder.budget = static_cast<long long>(duplication_budget * objects.size());
+	return builder.Build(refs, 0, Parallel_Build_Depth());
+}
\ No newline at end of file
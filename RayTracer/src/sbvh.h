@@ -0,0 +1,13 @@
+#pragma once
+#include <memory>
+#include "bvh.h"
+#include "hittable_list.h"
+
+//	Budget Build_Tree gives SPATIAL_BUILDER, see Build_SBVH
+constexpr float SBVH_DUPLICATION_BUDGET = 0.25F;
+
+//	Spatial split BVH (Stich et al. 2009). Where the best object split leaves the children
+//	overlapping, primitives may instead be cut by a plane and referenced from both sides,
+//	with node bounds shrunk to the clipped part. duplication_budget caps the extra references
+//	as a fraction of the primitive count, 0.25 allows at most 1.25x as many leaf references.
+std::shared_ptr<Hittable> Build_SBVH(const Hittable_List& list, float duplication_budget = SBVH_DUPLICATION_BUDGET);
\ No newline at end of file
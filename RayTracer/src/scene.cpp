@@ -5,10 +5,12 @@ Hittable_List Ball_Scene(std::vector<std::shared_ptr<Material>>& m) {
 	int index = 1;
 
 	auto ground_material = std::make_shared<Lambertian>(Colour(0.5, 0.5, 0.5), index);
-	world.Add(std::make_shared<Sphere>(Point3f(0, -1000, 0), 1000, ground_material, index));
+	world.Add(std::make_shared<Plane>(Point3f(0, 0, 0), Vec3f(0, 1, 0), ground_material, index));
 	m.push_back(ground_material);
 	index++;
 
+	//	The small spheres share one Sphere_Set, the large ones below stay Sphere objects
+	auto balls = std::make_shared<Sphere_Set>();
 	for (int a = -11; a < 11; a++)
 	{
 		for (int b = -11; b < 11; b++)
@@ -21,7 +23,7 @@ Hittable_List Ball_Scene(std::vector<std::shared_ptr<Material>>& m) {
 					//	Diffuse
 					auto albedo = Colour::Random() * Colour::Random();
 					sphere_material = std::make_shared<Lambertian>(albedo, index);
-					world.Add(std::make_shared<Sphere>(centre, 0.2, sphere_material, index));
+					balls->Add(centre, 0.2F, balls->Add_Material(sphere_material));
 					m.push_back(sphere_material);
 					index++;
 				}
@@ -30,20 +32,23 @@ Hittable_List Ball_Scene(std::vector<std::shared_ptr<Material>>& m) {
 					auto albedo = Colour::Random(0.5, 1);
 					auto fuzz = Random_Double(0, 0.5);
 					sphere_material = std::make_shared<Metal>(albedo, fuzz, index);
-					world.Add(std::make_shared<Sphere>(centre, 0.2, sphere_material, index));
+					balls->Add(centre, 0.2F, balls->Add_Material(sphere_material));
 					m.push_back(sphere_material);
 					index++;
 				}
 				else {
 					//	Glass
 					sphere_material = std::make_shared<Dielectric>(1.5, index);
-					world.Add(std::make_shared<Sphere>(centre, 0.2, sphere_material, index));
+					balls->Add(centre, 0.2F, balls->Add_Material(sphere_material));
 					m.push_back(sphere_material);
 					index++;
 				}
 			}
 		}
 	}
+	balls->Build();
+	world.Add(balls);
+
 	auto material1 = std::make_shared<Dielectric>(1.5, index);
 	world.Add(std::make_shared<Sphere>(Point3f(0, 1, 0), 1.0, material1, index));
 	m.push_back(ground_material);
@@ -61,7 +66,9 @@ Hittable_List Ball_Scene(std::vector<std::shared_ptr<Material>>& m) {
 	m.push_back(ground_material);
 	index++;
 
-	return Hittable_List(std::make_shared<BVH_Node>(world));
+	//	Only the sphere set and the large spheres are left at the top level, so a plain BVH does
+	world.Build(SAH_BUILDER, LINEAR_BVH);
+	return world;
 }
 
 Hittable_List Test_Scene(std::vector<std::shared_ptr<Material>>& m) {
@@ -89,7 +96,7 @@ Hittable_List Test_Scene(std::vector<std::shared_ptr<Material>>& m) {
 	index++;
 
 	auto ground_material = std::make_shared<Lambertian>(Colour(0.5, 0.5, 0.5), index);
-	world.Add(std::make_shared<Sphere>(Point3f(0, -1000, 0), 1000, ground_material, index));
+	world.Add(std::make_shared<Plane>(Point3f(0, 0, 0), Vec3f(0, 1, 0), ground_material, index));
 	m.push_back(ground_material);
 	index++;
 
@@ -98,7 +105,8 @@ Hittable_List Test_Scene(std::vector<std::shared_ptr<Material>>& m) {
 	m.push_back(material4);
 	index++;
 
-	return Hittable_List(std::make_shared<BVH_Node>(world));
+	world.Build(SAH_BUILDER, WIDE_BVH4);
+	return world;
 }
 
 Hittable_List My_Scene(std::vector<std::shared_ptr<Material>>& m) {
@@ -123,15 +131,13 @@ Hittable_List My_Scene(std::vector<std::shared_ptr<Material>>& m) {
 	m.push_back(floor_diffuse);
 	index++;
 
-	std::unique_ptr<Model> leg_one = std::make_unique<Model>("./objects/res/leg-1");
-	std::unique_ptr<Model> leg_two = std::make_unique<Model>("./objects/res/leg-2");
-	std::unique_ptr<Model> leg_three = std::make_unique<Model>("./objects/res/leg-3");
-	std::unique_ptr<Model> leg_four = std::make_unique<Model>("./objects/res/leg-4");
+	//	The four legs are the same mesh, leg-1 is instanced at the other corners
+	std::unique_ptr<Model> leg = std::make_unique<Model>("./objects/res/leg-1");
 	auto leg_diffuse = std::make_shared<Lambertian>(Colour(8.f / 255.f, 0.f / 255.f, 8.f / 255.f), index);
-	leg_one->AddToWorld(world, transform, leg_diffuse, index);
-	leg_two->AddToWorld(world, transform, leg_diffuse, index);
-	leg_three->AddToWorld(world, transform, leg_diffuse, index);
-	leg_four->AddToWorld(world, transform, leg_diffuse, index);
+	leg->AddToWorld(world, Vec3f(0, 0, 0), leg_diffuse, index);
+	leg->AddToWorld(world, Vec3f(2.936356F, 0, -7.371888F), leg_diffuse, index);
+	leg->AddToWorld(world, Vec3f(0, 0, -7.371888F), leg_diffuse, index);
+	leg->AddToWorld(world, Vec3f(2.936356F, 0, 0), leg_diffuse, index);
 	m.push_back(leg_diffuse);
 	index++;
 
@@ -202,6 +208,7 @@ Hittable_List My_Scene(std::vector<std::shared_ptr<Material>>& m) {
 	m.push_back(plant_mat);
 	index++;
 
+	//	The two largest meshes, as indexed Meshes, which only the default layout builds
 	std::unique_ptr<Model> mug_one = std::make_unique<Model>("./objects/res/mug-one");
 	std::unique_ptr<Model> mug_two = std::make_unique<Model>("./objects/res/mug-two");
 	auto mug_mat = std::make_shared<Metal>(Colour(52.f / 255.f, 154.f / 255.f, 166.f / 255.f), 0.3f, index);
@@ -225,5 +232,8 @@ Hittable_List My_Scene(std::vector<std::shared_ptr<Material>>& m) {
 	index++;	
 	
 	
-	return Hittable_List(std::make_shared<BVH_Node>(world));
+	//	The top level only holds a few dozen overlapping instances, the binary tree visits
+	//	fewer of them than the wide layouts. Spatial splits still pay off over instance boxes.
+	world.Build(SPATIAL_BUILDER, LINEAR_BVH);
+	return world;
 }
\ No newline at end of file
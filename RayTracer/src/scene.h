@@ -2,8 +2,11 @@
 #include "hittable_list.h"
 #include "material.h"
 #include "Sphere.h"
+#include "plane.h"
 #include "bvh.h"
+#include "tree.h"
 #include "model.h"
+#include "sphere_set.h"
 
 Hittable_List Ball_Scene(std::vector<std::shared_ptr<Material>>& m);
 Hittable_List Test_Scene(std::vector<std::shared_ptr<Material>>& m);
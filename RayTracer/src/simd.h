@@ -0,0 +1,71 @@
+#pragma once
+
+//	Lane helpers shared by the SIMD leaf kernels. SIMD_WIDTH floats per Lane, 8 with AVX and 4
+//	with SSE4.1. Without either the kernels fall back to scalar loops over SIMD_WIDTH = 4 lanes.
+#if defined(__AVX__)
+#define SIMD_AVX
+constexpr int SIMD_WIDTH = 8;
+#else
+#if defined(__SSE4_1__)
+#define SIMD_SSE
+#endif
+constexpr int SIMD_WIDTH = 4;
+#endif
+
+#if defined(SIMD_AVX) || defined(SIMD_SSE)
+#include <cstdint>
+#include <immintrin.h>
+
+#if defined(SIMD_AVX)
+typedef __m256 Lane;
+inline Lane Lane_Load(const float* p) { return _mm256_loadu_ps(p); }
+//	Widened in two SSE4.1 halves, AVX alone has no 256 bit integer conversions
+inline Lane Lane_Load_U16(const uint16_t* p) {
+	const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+	return _mm256_cvtepi32_ps(_mm256_set_m128i(_mm_cvtepu16_epi32(_mm_srli_si128(x, 8)), _mm_cvtepu16_epi32(x)));
+}
+inline void Lane_Store(float* p, Lane a) { _mm256_storeu_ps(p, a); }
+inline Lane Lane_Set(float x) { return _mm256_set1_ps(x); }
+inline Lane Lane_Add(Lane a, Lane b) { return _mm256_add_ps(a, b); }
+inline Lane Lane_Sub(Lane a, Lane b) { return _mm256_sub_ps(a, b); }
+inline Lane Lane_Mul(Lane a, Lane b) { return _mm256_mul_ps(a, b); }
+inline Lane Lane_Div(Lane a, Lane b) { return _mm256_div_ps(a, b); }
+inline Lane Lane_Sqrt(Lane a) { return _mm256_sqrt_ps(a); }
+inline Lane Lane_Min(Lane a, Lane b) { return _mm256_min_ps(a, b); }
+inline Lane Lane_Max(Lane a, Lane b) { return _mm256_max_ps(a, b); }
+inline Lane Lane_And(Lane a, Lane b) { return _mm256_and_ps(a, b); }
+inline Lane Lane_Or(Lane a, Lane b) { return _mm256_or_ps(a, b); }
+inline Lane Lane_Less_Equal(Lane a, Lane b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+inline Lane Lane_Equal(Lane a, Lane b) { return _mm256_cmp_ps(a, b, _CMP_EQ_OQ); }
+inline Lane Lane_Select(Lane mask, Lane a, Lane b) { return _mm256_blendv_ps(b, a, mask); }
+inline int Lane_Mask(Lane mask) { return _mm256_movemask_ps(mask); }
+inline Lane Lane_Horizontal_Min(Lane a) {
+	a = _mm256_min_ps(a, _mm256_permute_ps(a, _MM_SHUFFLE(2, 3, 0, 1)));
+	a = _mm256_min_ps(a, _mm256_permute_ps(a, _MM_SHUFFLE(1, 0, 3, 2)));
+	return _mm256_min_ps(a, _mm256_permute2f128_ps(a, a, 1));
+}
+#else
+typedef __m128 Lane;
+inline Lane Lane_Load(const float* p) { return _mm_loadu_ps(p); }
+inline Lane Lane_Load_U16(const uint16_t* p) { return _mm_cvtepi32_ps(_mm_cvtepu16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p)))); }
+inline void Lane_Store(float* p, Lane a) { _mm_storeu_ps(p, a); }
+inline Lane Lane_Set(float x) { return _mm_set1_ps(x); }
+inline Lane Lane_Add(Lane a, Lane b) { return _mm_add_ps(a, b); }
+inline Lane Lane_Sub(Lane a, Lane b) { return _mm_sub_ps(a, b); }
+inline Lane Lane_Mul(Lane a, Lane b) { return _mm_mul_ps(a, b); }
+inline Lane Lane_Div(Lane a, Lane b) { return _mm_div_ps(a, b); }
+inline Lane Lane_Sqrt(Lane a) { return _mm_sqrt_ps(a); }
+inline Lane Lane_Min(Lane a, Lane b) { return _mm_min_ps(a, b); }
+inline Lane Lane_Max(Lane a, Lane b) { return _mm_max_ps(a, b); }
+inline Lane Lane_And(Lane a, Lane b) { return _mm_and_ps(a, b); }
+inline Lane Lane_Or(Lane a, Lane b) { return _mm_or_ps(a, b); }
+inline Lane Lane_Less_Equal(Lane a, Lane b) { return _mm_cmple_ps(a, b); }
+inline Lane Lane_Equal(Lane a, Lane b) { return _mm_cmpeq_ps(a, b); }
+inline Lane Lane_Select(Lane mask, Lane a, Lane b) { return _mm_blendv_ps(b, a, mask); }
+inline int Lane_Mask(Lane mask) { return _mm_movemask_ps(mask); }
+inline Lane Lane_Horizontal_Min(Lane a) {
+	a = _mm_min_ps(a, _mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1)));
+	return _mm_min_ps(a, _mm_shuffle_ps(a, a, _MM_SHUFFLE(1, 0, 3, 2)));
+}
+#endif
+#endif
@@ -29,6 +29,26 @@ bool Sphere::Hit(const Ray& r, double t_min, double t_max, Hit_Record& rec) cons
 	return true;
 }
 
+bool Sphere::Occluded(const Ray& r, double t_min, double t_max) const {
+	Vec3f oc = r.Origin() - centre;
+	auto a = r.Direction().norm();
+
+	auto half_b = oc.dotProduct(r.Direction());
+	auto c = oc.norm() - radius * radius;
+	auto discriminant = half_b * half_b - a * c;
+	if (discriminant < 0) {
+		return false;
+	}
+	auto sqrtd = sqrt(discriminant);
+
+	auto root = (-half_b - sqrtd) / a;
+	if (root < t_min || t_max < root) {
+		root = (-half_b + sqrtd) / a;
+		return root >= t_min && root <= t_max;
+	}
+	return true;
+}
+
 bool Sphere::Bounding_Box(AABB& output_box) const
 {
 	output_box = AABB(centre - Vec3f(radius, radius, radius), centre + Vec3f(radius, radius, radius));
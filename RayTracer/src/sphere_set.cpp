@@ -0,0 +1,307 @@
+#include "sphere_set.h"
+#include "bvh.h"
+#include "timer.h"
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+uint16_t Sphere_Set::Add_Material(std::shared_ptr<Material> mat) {
+	auto it = material_indices.find(mat.get());
+	if (it != material_indices.end()) {
+		return it->second;
+	}
+	if (materials.size() > std::numeric_limits<uint16_t>::max()) {
+		throw std::length_error("Sphere_Set can not index more than 65536 materials");
+	}
+	const uint16_t index = static_cast<uint16_t>(materials.size());
+	material_indices[mat.get()] = index;
+	materials.push_back(std::move(mat));
+	return index;
+}
+
+void Sphere_Set::Add(const Point3f& centre, float radius, uint16_t material) {
+	pending.push_back(centre.x);
+	pending.push_back(centre.y);
+	pending.push_back(centre.z);
+	pending.push_back(radius);
+	pending_materials.push_back(material);
+}
+
+void Sphere_Set::Unpack() {
+	for (const auto& node : nodes) {
+		for (int slot = node.primitives_offset; slot < node.primitives_offset + node.n_primitives; slot++) {
+			const Sphere_Block& block = blocks[slot / SPHERE_BLOCK_WIDTH];
+			const int lane = slot % SPHERE_BLOCK_WIDTH;
+			Add(Point3f(block.centre[0][lane], block.centre[1][lane], block.centre[2][lane]), block.radius[lane], material_index[slot]);
+		}
+	}
+}
+
+void Sphere_Set::Build(int max_leaf_size) {
+	Timer t("Sphere set build time: ");
+	//	Spheres packed by an earlier Build go back in with the new ones
+	Unpack();
+	sphere_count = pending_materials.size();
+	nodes.clear();
+	blocks.clear();
+	material_index.clear();
+	if (sphere_count == 0) {
+		return;
+	}
+
+	std::vector<BVH_Primitive> prims(sphere_count);
+	for (size_t i = 0; i < sphere_count; i++) {
+		const Point3f centre(pending[4 * i], pending[4 * i + 1], pending[4 * i + 2]);
+		const float radius = pending[4 * i + 3];
+		prims[i].box = AABB(centre - Vec3f(radius, radius, radius), centre + Vec3f(radius, radius, radius));
+		prims[i].centroid = centre;
+		prims[i].index = i;
+	}
+	nodes.reserve(2 * sphere_count / std::max(1, max_leaf_size) + 1);
+	Build_Block_Tree(nodes, prims, 0, sphere_count, max_leaf_size, SPHERE_BLOCK_WIDTH);
+
+	size_t block_count = 0;
+	for (const auto& node : nodes) {
+		block_count += (node.n_primitives + SPHERE_BLOCK_WIDTH - 1) / SPHERE_BLOCK_WIDTH;
+	}
+	blocks.resize(block_count);
+	material_index.resize(block_count * SPHERE_BLOCK_WIDTH);
+
+	size_t slot = 0;
+	for (auto& node : nodes) {
+		if (node.n_primitives == 0) {
+			continue;
+		}
+		const size_t start = node.primitives_offset;
+		const size_t end = start + node.n_primitives;
+		node.primitives_offset = static_cast<int>(slot);
+		//	Padding lanes repeat the last sphere, so they can only ever report a hit it also has
+		for (size_t i = start; slot % SPHERE_BLOCK_WIDTH != 0 || i < end; i++, slot++) {
+			const size_t src = prims[std::min(i, end - 1)].index;
+			Sphere_Block& block = blocks[slot / SPHERE_BLOCK_WIDTH];
+			const int lane = slot % SPHERE_BLOCK_WIDTH;
+			for (int a = 0; a < 3; a++) {
+				block.centre[a][lane] = pending[4 * src + a];
+			}
+			block.radius[lane] = pending[4 * src + 3];
+			material_index[slot] = pending_materials[src];
+		}
+	}
+	std::vector<float>().swap(pending);
+	std::vector<uint16_t>().swap(pending_materials);
+	std::cerr << "Sphere set memory: " << Bytes() / 1024 << " KB for " << sphere_count << " spheres\n";
+}
+
+//	Ray broadcast to every lane of a block test, a is the squared length of the direction
+struct Sphere_Ray {
+	float origin[3];
+	float dir[3];
+	float a;
+};
+
+#if defined(SIMD_AVX) || defined(SIMD_SSE)
+//	Same quadratic as Sphere::Hit on every lane, nearest root in range first. Returns the mask
+//	of lanes hit within [t_min, t_max]. In floats b^2 - ac cancels badly once the ray starts
+//	far from a small sphere, so the discriminant comes from the closest approach to the centre,
+//	a * (r^2 - |oc - (b / a) d|^2), which is the same value.
+inline Lane Sphere_Block_Hits(const Sphere_Block& block, const Sphere_Ray& r, float t_min, float t_max, Lane& t) {
+	const Lane ocx = Lane_Sub(Lane_Set(r.origin[0]), Lane_Load(block.centre[0]));
+	const Lane ocy = Lane_Sub(Lane_Set(r.origin[1]), Lane_Load(block.centre[1]));
+	const Lane ocz = Lane_Sub(Lane_Set(r.origin[2]), Lane_Load(block.centre[2]));
+	const Lane radius = Lane_Load(block.radius);
+	const Lane a = Lane_Set(r.a);
+
+	const Lane half_b = Lane_Add(Lane_Add(Lane_Mul(ocx, Lane_Set(r.dir[0])), Lane_Mul(ocy, Lane_Set(r.dir[1]))), Lane_Mul(ocz, Lane_Set(r.dir[2])));
+	const Lane f = Lane_Div(half_b, a);
+	const Lane lx = Lane_Sub(ocx, Lane_Mul(f, Lane_Set(r.dir[0])));
+	const Lane ly = Lane_Sub(ocy, Lane_Mul(f, Lane_Set(r.dir[1])));
+	const Lane lz = Lane_Sub(ocz, Lane_Mul(f, Lane_Set(r.dir[2])));
+	const Lane l2 = Lane_Add(Lane_Add(Lane_Mul(lx, lx), Lane_Mul(ly, ly)), Lane_Mul(lz, lz));
+	const Lane discriminant = Lane_Mul(a, Lane_Sub(Lane_Mul(radius, radius), l2));
+	const Lane hit = Lane_Less_Equal(Lane_Set(0.F), discriminant);
+	const Lane sqrtd = Lane_Sqrt(discriminant);
+
+	const Lane near_root = Lane_Div(Lane_Sub(Lane_Sub(Lane_Set(0.F), half_b), sqrtd), a);
+	const Lane far_root = Lane_Div(Lane_Add(Lane_Sub(Lane_Set(0.F), half_b), sqrtd), a);
+	const Lane near_ok = Lane_And(Lane_Less_Equal(Lane_Set(t_min), near_root), Lane_Less_Equal(near_root, Lane_Set(t_max)));
+	const Lane far_ok = Lane_And(Lane_Less_Equal(Lane_Set(t_min), far_root), Lane_Less_Equal(far_root, Lane_Set(t_max)));
+	t = Lane_Select(near_ok, near_root, far_root);
+	return Lane_And(hit, Lane_Or(near_ok, far_ok));
+}
+
+inline int Closest_In_Block(const Sphere_Block& block, const Sphere_Ray& r, float t_min, float t_max, float& t) {
+	Lane lane_t;
+	const Lane mask = Sphere_Block_Hits(block, r, t_min, t_max, lane_t);
+	if (Lane_Mask(mask) == 0) {
+		return -1;
+	}
+	const Lane masked_t = Lane_Select(mask, lane_t, Lane_Set(std::numeric_limits<float>::infinity()));
+	const int nearest = Lane_Mask(Lane_And(mask, Lane_Equal(masked_t, Lane_Horizontal_Min(masked_t))));
+	int lane = 0;
+	while (!(nearest & (1 << lane))) {
+		lane++;
+	}
+	float ts[SPHERE_BLOCK_WIDTH];
+	std::memcpy(ts, &lane_t, sizeof(ts));
+	t = ts[lane];
+	return lane;
+}
+
+inline bool Any_In_Block(const Sphere_Block& block, const Sphere_Ray& r, float t_min, float t_max) {
+	Lane t;
+	return Lane_Mask(Sphere_Block_Hits(block, r, t_min, t_max, t)) != 0;
+}
+#else
+inline bool Lane_Hit(const Sphere_Block& block, int lane, const Sphere_Ray& r, float t_min, float t_max, float& t) {
+	const Vec3f oc(r.origin[0] - block.centre[0][lane], r.origin[1] - block.centre[1][lane], r.origin[2] - block.centre[2][lane]);
+	const Vec3f dir(r.dir[0], r.dir[1], r.dir[2]);
+	const float half_b = oc.dotProduct(dir);
+	const float discriminant = r.a * (block.radius[lane] * block.radius[lane] - (oc - dir * (half_b / r.a)).norm());
+	if (discriminant < 0) {
+		return false;
+	}
+	const float sqrtd = std::sqrt(discriminant);
+	t = (-half_b - sqrtd) / r.a;
+	if (t < t_min || t_max < t) {
+		t = (-half_b + sqrtd) / r.a;
+		return t >= t_min && t <= t_max;
+	}
+	return true;
+}
+
+inline int Closest_In_Block(const Sphere_Block& block, const Sphere_Ray& r, float t_min, float t_max, float& t) {
+	int closest = -1;
+	for (int lane = 0; lane < SPHERE_BLOCK_WIDTH; lane++) {
+		float lane_t;
+		if (Lane_Hit(block, lane, r, t_min, t_max, lane_t)) {
+			t_max = lane_t;
+			t = lane_t;
+			closest = lane;
+		}
+	}
+	return closest;
+}
+
+inline bool Any_In_Block(const Sphere_Block& block, const Sphere_Ray& r, float t_min, float t_max) {
+	for (int lane = 0; lane < SPHERE_BLOCK_WIDTH; lane++) {
+		float t;
+		if (Lane_Hit(block, lane, r, t_min, t_max, t)) {
+			return true;
+		}
+	}
+	return false;
+}
+#endif
+
+bool Sphere_Set::Hit(const Ray& r, double t_min, double t_max, Hit_Record& rec) const {
+	const Point3f origin = r.Origin();
+	const Vec3f dir = r.Direction();
+	const Vec3f inv_dir(1.F / dir.x, 1.F / dir.y, 1.F / dir.z);
+	const Sphere_Ray lanes = { { origin.x, origin.y, origin.z }, { dir.x, dir.y, dir.z }, dir.norm() };
+
+	float closest_so_far = static_cast<float>(t_max);
+	int closest_sphere = -1;
+	Traverse_Ray(nodes, origin, inv_dir, static_cast<float>(t_min), closest_so_far, [&](const Linear_BVH_Node& node) {
+		const int first = node.primitives_offset / SPHERE_BLOCK_WIDTH;
+		const int end = first + (node.n_primitives + SPHERE_BLOCK_WIDTH - 1) / SPHERE_BLOCK_WIDTH;
+		for (int b = first; b < end; b++) {
+			float t;
+			int lane = Closest_In_Block(blocks[b], lanes, static_cast<float>(t_min), closest_so_far, t);
+			if (lane >= 0) {
+				closest_so_far = t;
+				closest_sphere = b * SPHERE_BLOCK_WIDTH + lane;
+			}
+		}
+		return false;
+	});
+	if (closest_sphere < 0) {
+		return false;
+	}
+
+	const Sphere_Block& block = blocks[closest_sphere / SPHERE_BLOCK_WIDTH];
+	const int lane = closest_sphere % SPHERE_BLOCK_WIDTH;
+	const Point3f centre(block.centre[0][lane], block.centre[1][lane], block.centre[2][lane]);
+	rec.t = closest_so_far;
+	rec.p = r.At(rec.t);
+	rec.Set_Face_Normal(r, (rec.p - centre) / block.radius[lane]);
+	rec.mat_ptr = materials[material_index[closest_sphere]];
+	return true;
+}
+
+uint64_t Sphere_Set::Hit_Packet(Ray_Packet& packet, uint64_t active, double t_min, Hit_Record* recs) const {
+	int closest_sphere[PACKET_SIZE];
+	uint64_t hits = 0;
+
+	Traverse_Packet(nodes, packet, active, static_cast<float>(t_min), [&](const Linear_BVH_Node& node, uint64_t lanes) {
+		uint64_t leaf_hits = 0;
+		const int first = node.primitives_offset / SPHERE_BLOCK_WIDTH;
+		const int end = first + (node.n_primitives + SPHERE_BLOCK_WIDTH - 1) / SPHERE_BLOCK_WIDTH;
+		for (int lane = 0; lane < packet.count; lane++) {
+			if (!Lane_Active(lanes, lane)) {
+				continue;
+			}
+			const Vec3f dir(packet.dir[0][lane], packet.dir[1][lane], packet.dir[2][lane]);
+			const Sphere_Ray r = { { packet.origin[0][lane], packet.origin[1][lane], packet.origin[2][lane] },
+				{ dir.x, dir.y, dir.z }, dir.norm() };
+			for (int b = first; b < end; b++) {
+				float t;
+				const int hit = Closest_In_Block(blocks[b], r, static_cast<float>(t_min), packet.t_max[lane], t);
+				if (hit >= 0) {
+					packet.t_max[lane] = t;
+					closest_sphere[lane] = b * SPHERE_BLOCK_WIDTH + hit;
+					leaf_hits |= uint64_t(1) << lane;
+				}
+			}
+		}
+		hits |= leaf_hits;
+		return leaf_hits != 0;
+	});
+
+	for (int lane = 0; lane < packet.count; lane++) {
+		if (!Lane_Active(hits, lane)) {
+			continue;
+		}
+		const Ray r = packet.Lane_Ray(lane);
+		const Sphere_Block& block = blocks[closest_sphere[lane] / SPHERE_BLOCK_WIDTH];
+		const int slot = closest_sphere[lane] % SPHERE_BLOCK_WIDTH;
+		const Point3f centre(block.centre[0][slot], block.centre[1][slot], block.centre[2][slot]);
+		Hit_Record& rec = recs[lane];
+		rec.t = packet.t_max[lane];
+		rec.p = r.At(rec.t);
+		rec.Set_Face_Normal(r, (rec.p - centre) / block.radius[slot]);
+		rec.mat_ptr = materials[material_index[closest_sphere[lane]]];
+	}
+	return hits;
+}
+
+bool Sphere_Set::Occluded(const Ray& r, double t_min, double t_max) const {
+	const Point3f origin = r.Origin();
+	const Vec3f dir = r.Direction();
+	const Vec3f inv_dir(1.F / dir.x, 1.F / dir.y, 1.F / dir.z);
+	const Sphere_Ray lanes = { { origin.x, origin.y, origin.z }, { dir.x, dir.y, dir.z }, dir.norm() };
+
+	const float t_far = static_cast<float>(t_max);
+	return Traverse_Ray(nodes, origin, inv_dir, static_cast<float>(t_min), t_far, [&](const Linear_BVH_Node& node) {
+		const int first = node.primitives_offset / SPHERE_BLOCK_WIDTH;
+		const int end = first + (node.n_primitives + SPHERE_BLOCK_WIDTH - 1) / SPHERE_BLOCK_WIDTH;
+		for (int b = first; b < end; b++) {
+			if (Any_In_Block(blocks[b], lanes, static_cast<float>(t_min), t_far)) {
+				return true;
+			}
+		}
+		return false;
+	});
+}
+
+bool Sphere_Set::Bounding_Box(AABB& output_box) const {
+	if (nodes.empty()) {
+		return false;
+	}
+	output_box = Node_Box(nodes.front());
+	return true;
+}
+
+size_t Sphere_Set::Bytes() const {
+	return blocks.capacity() * sizeof(Sphere_Block) + material_index.capacity() * sizeof(uint16_t)
+		+ nodes.capacity() * sizeof(Linear_BVH_Node);
+}
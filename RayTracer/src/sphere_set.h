@@ -0,0 +1,60 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include "hittable.h"
+#include "linear_bvh.h"
+#include "simd.h"
+
+constexpr int SPHERE_BLOCK_WIDTH = SIMD_WIDTH;
+
+//	Structure of arrays copy of the spheres of a leaf, one lane per sphere. Lanes past the end
+//	of a leaf repeat its last sphere.
+struct Sphere_Block {
+	float centre[3][SPHERE_BLOCK_WIDTH];
+	float radius[SPHERE_BLOCK_WIDTH];
+};
+
+//	Many spheres as one primitive, about 20 bytes each instead of a heap allocated Sphere with
+//	its own shared_ptr<Material>. Spheres are float centres and radii with a 16 bit index into
+//	a shared material table, packed into SIMD blocks under a Linear_BVH_Node tree.
+//	Float precision suits small spheres near the origin, huge ones like a ground sphere are
+//	better left as Sphere objects.
+class Sphere_Set : public Hittable {
+public:
+	Sphere_Set() {}
+
+	//	Returns the index to pass to Add, the same one for a material added before. Throws
+	//	std::length_error past 65536 distinct materials.
+	uint16_t Add_Material(std::shared_ptr<Material> mat);
+	void Add(const Point3f& centre, float radius, uint16_t material);
+	//	Builds the tree over every sphere added so far, including those of earlier builds.
+	//	Nothing is hit before it is called.
+	void Build(int max_leaf_size = BVH_MAX_LEAF_SIZE);
+
+	virtual bool Hit(const Ray& r, double t_min, double t_max, Hit_Record& rec) const override;
+	virtual bool Bounding_Box(AABB& output_box) const override;
+	virtual bool Occluded(const Ray& r, double t_min, double t_max) const override;
+	virtual uint64_t Hit_Packet(Ray_Packet& packet, uint64_t active, double t_min, Hit_Record* recs) const override;
+	virtual bool Packet_Traversal() const override { return true; }
+
+	size_t Sphere_Count() const { return sphere_count; }
+	size_t Bytes() const;
+
+public:
+	std::vector<Sphere_Block> blocks;			//	sphere i is lane i % SPHERE_BLOCK_WIDTH of block i / SPHERE_BLOCK_WIDTH
+	std::vector<uint16_t> material_index;		//	per lane
+	std::vector<std::shared_ptr<Material>> materials;
+	std::vector<Linear_BVH_Node> nodes;
+
+private:
+	//	Moves the spheres of the current leaves back into pending
+	void Unpack();
+
+	std::unordered_map<const Material*, uint16_t> material_indices;
+	//	Spheres waiting for Build, released by it
+	std::vector<float> pending;				//	x, y, z, radius per sphere
+	std::vector<uint16_t> pending_materials;
+	size_t sphere_count = 0;
+};
@@ -4,6 +4,7 @@
 #include <vector>
 #include <thread>
 #include <queue>
+#include <algorithm>
 
 class ThreadPool {
 public:
@@ -68,4 +69,28 @@ private:
 		for (auto& thread : mThreads)
 			thread.join();
 	}
-};
\ No newline at end of file
+};
+
+inline size_t Parallel_Chunks(size_t count) {
+	size_t chunks = std::max(1u, std::thread::hardware_concurrency());
+	return std::min(chunks, std::max<size_t>(1, count));
+}
+
+//	Splits [0, count) into Parallel_Chunks(count) contiguous chunks, one thread each, and blocks
+//	until every chunk is done. func(begin, end, chunk) is called once per chunk.
+template<typename Func>
+void Parallel_For(size_t count, Func func) {
+	size_t chunks = Parallel_Chunks(count);
+	size_t chunk_size = (count + chunks - 1) / chunks;
+
+	std::vector<std::thread> threads;
+	for (size_t c = 1; c < chunks; c++) {
+		size_t begin = std::min(count, c * chunk_size);
+		size_t end = std::min(count, begin + chunk_size);
+		threads.emplace_back(func, begin, end, c);
+	}
+	func(0, std::min(count, chunk_size), 0);
+
+	for (auto& thread : threads)
+		thread.join();
+}
\ No newline at end of file
@@ -3,12 +3,25 @@
 #include <vector>
 #include "hittable.h"
 #include "bvh.h"
+#include "lbvh.h"
+#include "sbvh.h"
+#include "linear_bvh.h"
+#include "wide_bvh.h"
+#include "quantized_bvh.h"
+#include "uniform_grid.h"
+#include "lazy_bvh.h"
+#include "dynamic_bvh.h"
 #include "enum.h"
 #include "Triangle.h"
 #include "Sphere.h"
 #include "material.h"
 
-void Traverse_Tree(std::shared_ptr<Hittable> n, std::vector<std::shared_ptr<Hittable>>& arr);
+//	Builds a BVH_Node tree over the list with the chosen builder
+std::shared_ptr<Hittable> Build_Tree(const Hittable_List& list, int builder);
 
-std::shared_ptr<Hittable> Create_Tree(std::vector<Hittable*>& objs, std::vector<std::shared_ptr<Material>>& mtl);
-std::vector<std::shared_ptr<Material>> Create_Materials(std::vector<Material*>& mtls);
\ No newline at end of file
+//	Converts a built BVH_Node tree into the traversal layout used for rendering. The node
+//	order only applies to the wide layouts, Linear_BVH relies on depth first order.
+std::shared_ptr<Hittable> Flatten_Tree(std::shared_ptr<Hittable> root, int layout, int order = DEPTH_FIRST_ORDER);
+
+//	Any of the layouts above, a UNIFORM_GRID, a LAZY_BVH or a DYNAMIC_BVH, the builder only matters for the trees
+std::shared_ptr<Hittable> Build_Accelerator(const Hittable_List& list, int builder, int layout);
\ No newline at end of file
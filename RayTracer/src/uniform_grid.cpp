@@ -0,0 +1,198 @@
+#include "uniform_grid.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include "timer.h"
+
+constexpr int GRID_MAX_RESOLUTION = 256;
+constexpr float GRID_LARGE_AREA = 1000.F;	//	times the median object area
+
+Uniform_Grid::Uniform_Grid(const Hittable_List& list, float density) {
+	Timer t("Grid build time: ");
+
+	std::vector<AABB> boxes;
+	std::vector<float> areas;
+	for (const auto& object : list.objects) {
+		AABB box;
+		object->Bounding_Box(box);
+		boxes.push_back(box);
+		areas.push_back(box.Surface_Area());
+	}
+	std::vector<float> sorted = areas;
+	std::nth_element(sorted.begin(), sorted.begin() + sorted.size() / 2, sorted.end());
+	const float large_area = sorted.empty() ? 0.F : sorted[sorted.size() / 2] * GRID_LARGE_AREA;
+
+	std::vector<AABB> grid_boxes;
+	bounds = Empty_Box();
+	grid_bounds = Empty_Box();
+	for (size_t i = 0; i < list.objects.size(); i++) {
+		bounds = Enclosing_Box(bounds, boxes[i]);
+		if (large_area > 0 && areas[i] > large_area) {
+			large.push_back(list.objects[i]);
+			continue;
+		}
+		objects.push_back(list.objects[i]);
+		grid_boxes.push_back(boxes[i]);
+		grid_bounds = Enclosing_Box(grid_bounds, boxes[i]);
+	}
+	if (objects.empty()) {
+		grid_bounds = AABB();
+	}
+
+	//	Cells close to cubic with about density objects each
+	Vec3f extent = grid_bounds.Max() - grid_bounds.Min();
+	for (int a = 0; a < 3; a++) {
+		extent[a] = std::max(extent[a], 1e-4F);
+	}
+	float cells_per_unit = std::cbrt(density * objects.size() / (extent.x * extent.y * extent.z));
+	for (int a = 0; a < 3; a++) {
+		resolution[a] = std::max(1, std::min(GRID_MAX_RESOLUTION, static_cast<int>(std::round(extent[a] * cells_per_unit))));
+		cell_size[a] = extent[a] / resolution[a];
+	}
+	grid_bounds = AABB(grid_bounds.Min(), grid_bounds.Min() + extent);
+
+	//	Count then fill, leaving the lists packed in cell order
+	const int n_cells = resolution[0] * resolution[1] * resolution[2];
+	cell_start.assign(n_cells + 1, 0);
+	auto for_cells = [&](const AABB& box, auto func) {
+		int lo[3], hi[3];
+		for (int a = 0; a < 3; a++) {
+			lo[a] = Cell(box.Min(), a);
+			hi[a] = Cell(box.Max(), a);
+		}
+		for (int z = lo[2]; z <= hi[2]; z++) {
+			for (int y = lo[1]; y <= hi[1]; y++) {
+				for (int x = lo[0]; x <= hi[0]; x++) {
+					func(x + resolution[0] * (y + resolution[1] * z));
+				}
+			}
+		}
+	};
+	for (const auto& box : grid_boxes) {
+		for_cells(box, [&](int cell) { cell_start[cell + 1]++; });
+	}
+	for (int i = 0; i < n_cells; i++) {
+		cell_start[i + 1] += cell_start[i];
+	}
+	cell_objects.resize(cell_start[n_cells]);
+	std::vector<uint32_t> fill(cell_start.begin(), cell_start.end() - 1);
+	for (size_t i = 0; i < grid_boxes.size(); i++) {
+		for_cells(grid_boxes[i], [&](int cell) { cell_objects[fill[cell]++] = static_cast<uint32_t>(i); });
+	}
+
+	std::cerr << "Grid " << resolution[0] << "x" << resolution[1] << "x" << resolution[2] << ", "
+		<< cell_objects.size() << " references, " << large.size() << " large objects\n";
+}
+
+int Uniform_Grid::Cell(const Point3f& p, int axis) const {
+	int c = static_cast<int>((p[axis] - grid_bounds.Min()[axis]) / cell_size[axis]);
+	return std::max(0, std::min(resolution[axis] - 1, c));
+}
+
+template<typename Visit>
+bool Uniform_Grid::Walk(const Ray& r, double t_min, const double& t_max, Visit visit) const {
+	if (objects.empty()) {
+		return false;
+	}
+	const Point3f origin = r.Origin();
+	const Vec3f dir = r.Direction();
+
+	//	Clip the ray to the grid
+	float t_enter = static_cast<float>(t_min);
+	float t_exit = static_cast<float>(t_max);
+	for (int a = 0; a < 3; a++) {
+		float inv = 1.F / dir[a];
+		float t0 = (grid_bounds.Min()[a] - origin[a]) * inv;
+		float t1 = (grid_bounds.Max()[a] - origin[a]) * inv;
+		if (inv < 0.F) {
+			std::swap(t0, t1);
+		}
+		t_enter = t0 > t_enter ? t0 : t_enter;
+		t_exit = t1 < t_exit ? t1 : t_exit;
+		if (t_exit < t_enter) {
+			return false;
+		}
+	}
+
+	const Point3f start = origin + dir * t_enter;
+	int cell[3], step[3], stop[3];
+	float t_next[3], t_delta[3];
+	for (int a = 0; a < 3; a++) {
+		cell[a] = Cell(start, a);
+		if (dir[a] > 0.F) {
+			step[a] = 1;
+			stop[a] = resolution[a];
+			t_delta[a] = cell_size[a] / dir[a];
+			t_next[a] = t_enter + (grid_bounds.Min()[a] + (cell[a] + 1) * cell_size[a] - start[a]) / dir[a];
+		}
+		else if (dir[a] < 0.F) {
+			step[a] = -1;
+			stop[a] = -1;
+			t_delta[a] = -cell_size[a] / dir[a];
+			t_next[a] = t_enter + (grid_bounds.Min()[a] + cell[a] * cell_size[a] - start[a]) / dir[a];
+		}
+		else {
+			step[a] = 0;
+			stop[a] = -1;
+			t_delta[a] = 0.F;
+			t_next[a] = std::numeric_limits<float>::infinity();
+		}
+	}
+
+	while (true) {
+		const int index = cell[0] + resolution[0] * (cell[1] + resolution[1] * cell[2]);
+		for (uint32_t i = cell_start[index]; i < cell_start[index + 1]; i++) {
+			if (visit(*objects[cell_objects[i]])) {
+				return true;
+			}
+		}
+
+		//	A hit closer than the next cell boundary can not be beaten further along
+		const int a = t_next[0] < t_next[1] ? (t_next[0] < t_next[2] ? 0 : 2) : (t_next[1] < t_next[2] ? 1 : 2);
+		if (t_max < t_next[a] || t_exit < t_next[a]) {
+			return false;
+		}
+		cell[a] += step[a];
+		if (cell[a] == stop[a]) {
+			return false;
+		}
+		t_next[a] += t_delta[a];
+	}
+}
+
+bool Uniform_Grid::Hit(const Ray& r, double t_min, double t_max, Hit_Record& rec) const {
+	bool hit_anything = false;
+	double closest_so_far = t_max;
+	for (const auto& object : large) {
+		if (object->Hit(r, t_min, closest_so_far, rec)) {
+			hit_anything = true;
+			closest_so_far = rec.t;
+		}
+	}
+
+	Walk(r, t_min, closest_so_far, [&](const Hittable& object) {
+		if (object.Hit(r, t_min, closest_so_far, rec)) {
+			hit_anything = true;
+			closest_so_far = rec.t;
+		}
+		return false;
+	});
+	return hit_anything;
+}
+
+bool Uniform_Grid::Occluded(const Ray& r, double t_min, double t_max) const {
+	for (const auto& object : large) {
+		if (object->Occluded(r, t_min, t_max)) {
+			return true;
+		}
+	}
+	return Walk(r, t_min, t_max, [&](const Hittable& object) {
+		return object.Occluded(r, t_min, t_max);
+	});
+}
+
+bool Uniform_Grid::Bounding_Box(AABB& output_box) const {
+	output_box = bounds;
+	return !large.empty() || !objects.empty();
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "hittable.h"
+#include "hittable_list.h"
+
+//	Regular grid of cells walked with a 3D-DDA, each cell lists the objects overlapping it.
+//	Suits many similar sized objects spread evenly, such as the spheres in Ball_Scene.
+class Uniform_Grid : public Hittable {
+public:
+	//	density is the target number of objects per cell
+	Uniform_Grid(const Hittable_List& list, float density = 2.F);
+
+	virtual bool Hit(const Ray& r, double t_min, double t_max, Hit_Record& rec) const override;
+	virtual bool Bounding_Box(AABB& output_box) const override;
+	virtual bool Occluded(const Ray& r, double t_min, double t_max) const override;
+
+public:
+	//	Objects far larger than the rest, like a ground sphere, would stretch the grid over
+	//	empty space so they are kept out of it and tested on every ray
+	std::vector<std::shared_ptr<Hittable>> large;
+	std::vector<std::shared_ptr<Hittable>> objects;
+	std::vector<uint32_t> cell_start;	//	objects of cell i are cell_objects[cell_start[i], cell_start[i + 1])
+	std::vector<uint32_t> cell_objects;
+	AABB grid_bounds;
+	AABB bounds;
+	int resolution[3];
+	Vec3f cell_size;
+
+private:
+	//	Calls visit(object) for every object in the cells along the ray until it returns true
+	//	or the ray leaves the grid, t_max is re-read each cell so visit can shorten it
+	template<typename Visit>
+	bool Walk(const Ray& r, double t_min, const double& t_max, Visit visit) const;
+	int Cell(const Point3f& p, int axis) const;
+};
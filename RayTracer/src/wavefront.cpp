@@ -0,0 +1,260 @@
+#include "wavefront.h"
+#include "lbvh.h"
+#include "threadpool.h"
+
+//	Sorted rays are traced as one packet only when their directions fit in a cone this narrow
+//	(cosine of its half angle), diffuse bounces diverge too much for a shared traversal to pay
+constexpr float PACKET_COHERENCE = 0.99F;
+
+constexpr size_t SORT_BUCKETS = 8 << 12;
+
+void Ray_Queue::Resize(size_t n) {
+	for (int a = 0; a < 3; a++) {
+		origin[a].resize(n);
+		dir[a].resize(n);
+	}
+	path.resize(n);
+	throughput.resize(n);
+}
+
+void Ray_Queue::Set(size_t i, int ray_path, const Ray& r, const Colour& ray_throughput) {
+	const Point3f o = r.Origin();
+	const Vec3f d = r.Direction();
+	for (int a = 0; a < 3; a++) {
+		origin[a][i] = o[a];
+		dir[a][i] = d[a];
+	}
+	path[i] = ray_path;
+	throughput[i] = ray_throughput;
+}
+
+Ray Ray_Queue::Get(size_t i) const {
+	return Ray(Point3f(origin[0][i], origin[1][i], origin[2][i]), Vec3f(dir[0][i], dir[1][i], dir[2][i]));
+}
+
+void Wavefront_Integrator::Add_Path(const Ray& r, const Colour& path_background) {
+	const int path = static_cast<int>(radiance.size());
+	radiance.push_back(Colour(0, 0, 0));
+	background.push_back(path_background);
+	rays.Resize(rays.Size() + 1);
+	rays.Set(rays.Size() - 1, path, r, Colour(1, 1, 1));
+}
+
+void Wavefront_Integrator::Clear() {
+	radiance.clear();
+	background.clear();
+	rays.Resize(0);
+}
+
+void Wavefront_Integrator::Trace() {
+	for (int depth = 0; depth < max_depth && rays.Size() > 0; depth++) {
+		//	Camera rays arrive in tile order, which is already as coherent as it gets
+		if (depth == 0) {
+			std::swap(rays, sorted);
+		}
+		else {
+			Sort_Rays();
+		}
+		Trace_Rays();
+		Shade_Hits(depth + 1);
+	}
+	rays.Resize(0);
+}
+
+//	Key is the direction octant, then a 16^3 Morton cell of the origin within the queue's
+//	bounds. That is few enough buckets for one counting sort pass straight into sorted.
+void Wavefront_Integrator::Sort_Rays() {
+	const size_t n = rays.Size();
+	Point3f lo(static_cast<float>(infinity));
+	Point3f hi(-static_cast<float>(infinity));
+	for (size_t i = 0; i < n; i++) {
+		for (int a = 0; a < 3; a++) {
+			lo[a] = std::min(lo[a], rays.origin[a][i]);
+			hi[a] = std::max(hi[a], rays.origin[a][i]);
+		}
+	}
+	Vec3f inv_extent;
+	for (int a = 0; a < 3; a++) {
+		inv_extent[a] = hi[a] > lo[a] ? 1.F / (hi[a] - lo[a]) : 0.F;
+	}
+
+	const size_t chunks = Parallel_Chunks(n);
+	keys.resize(n);
+	offsets.assign(chunks * SORT_BUCKETS, 0);
+	Parallel_For(n, [&](size_t first, size_t last, size_t chunk) {
+		size_t* counts = &offsets[chunk * SORT_BUCKETS];
+		for (size_t i = first; i < last; i++) {
+			const uint32_t octant = (rays.dir[0][i] < 0.F ? 4 : 0) | (rays.dir[1][i] < 0.F ? 2 : 0) | (rays.dir[2][i] < 0.F ? 1 : 0);
+			const Point3f o(rays.origin[0][i], rays.origin[1][i], rays.origin[2][i]);
+			keys[i] = static_cast<uint16_t>(octant << 12 | Morton_Code((o - lo) * inv_extent) >> 51);
+			counts[keys[i]]++;
+		}
+	});
+	size_t sum = 0;
+	for (size_t bucket = 0; bucket < SORT_BUCKETS; bucket++) {
+		for (size_t chunk = 0; chunk < chunks; chunk++) {
+			const size_t count = offsets[chunk * SORT_BUCKETS + bucket];
+			offsets[chunk * SORT_BUCKETS + bucket] = sum;
+			sum += count;
+		}
+	}
+
+	sorted.Resize(n);
+	Parallel_For(n, [&](size_t first, size_t last, size_t chunk) {
+		size_t* next = &offsets[chunk * SORT_BUCKETS];
+		for (size_t i = first; i < last; i++) {
+			const size_t to = next[keys[i]]++;
+			for (int a = 0; a < 3; a++) {
+				sorted.origin[a][to] = rays.origin[a][i];
+				sorted.dir[a][to] = rays.dir[a][i];
+			}
+			sorted.path[to] = rays.path[i];
+			sorted.throughput[to] = rays.throughput[i];
+		}
+	});
+}
+
+static bool Coherent(const Ray_Packet& packet) {
+	const Vec3f axis = Vec3f(packet.dir[0][0], packet.dir[1][0], packet.dir[2][0]).normalize();
+	for (int lane = 1; lane < packet.count; lane++) {
+		const Vec3f d = Vec3f(packet.dir[0][lane], packet.dir[1][lane], packet.dir[2][lane]).normalize();
+		if (d.dotProduct(axis) < PACKET_COHERENCE) {
+			return false;
+		}
+	}
+	return true;
+}
+
+//	Consecutive sorted rays go out together, as a packet when coherent or one by one in
+//	queue order otherwise
+void Wavefront_Integrator::Trace_Rays() {
+	const size_t n = sorted.Size();
+	const size_t packets = (n + PACKET_SIZE - 1) / PACKET_SIZE;
+	recs.resize(n);
+	hit.resize(n);
+	Parallel_For(packets, [&](size_t first, size_t last, size_t) {
+		Ray_Packet packet;
+		for (size_t p = first; p < last; p++) {
+			const size_t base = p * PACKET_SIZE;
+			packet.count = static_cast<int>(std::min<size_t>(PACKET_SIZE, n - base));
+			for (int a = 0; a < 3; a++) {
+				for (int lane = 0; lane < packet.count; lane++) {
+					packet.origin[a][lane] = sorted.origin[a][base + lane];
+					packet.dir[a][lane] = sorted.dir[a][base + lane];
+					packet.inv_dir[a][lane] = 1.F / sorted.dir[a][base + lane];
+				}
+			}
+			for (int lane = 0; lane < packet.count; lane++) {
+				packet.t_max[lane] = static_cast<float>(infinity);
+			}
+			if (!Coherent(packet)) {
+				for (int lane = 0; lane < packet.count; lane++) {
+					hit[base + lane] = world.Hit(packet.Lane_Ray(lane), 0.001, infinity, recs[base + lane]);
+				}
+				continue;
+			}
+			const uint64_t active = packet.count == PACKET_SIZE ? ~uint64_t(0) : (uint64_t(1) << packet.count) - 1;
+			const uint64_t hits = world.Hit_Packet(packet, active, 0.001, &recs[base]);
+			for (int lane = 0; lane < packet.count; lane++) {
+				hit[base + lane] = Lane_Active(hits, lane);
+			}
+		}
+	});
+}
+
+//	Batches only ever hold M, so the qualified calls skip the virtual dispatch. Material
+//	itself covers any type without a batch of its own.
+template<typename M>
+static bool Scatter_As(const Material& mat, const Ray& r_in, const Hit_Record& rec, Colour& attenuation, Ray& scattered) {
+	return static_cast<const M&>(mat).M::Scatter(r_in, rec, attenuation, scattered);
+}
+
+template<>
+bool Scatter_As<Material>(const Material& mat, const Ray& r_in, const Hit_Record& rec, Colour& attenuation, Ray& scattered) {
+	return mat.Scatter(r_in, rec, attenuation, scattered);
+}
+
+template<typename M>
+static Colour Emitted_As(const Material& mat) {
+	return static_cast<const M&>(mat).M::Emitted();
+}
+
+template<>
+Colour Emitted_As<Material>(const Material& mat) {
+	return mat.Emitted();
+}
+
+//	Each path has one ray per bounce, so the batch's writes to radiance never collide
+template<typename M>
+void Wavefront_Integrator::Shade_Batch(const std::vector<int>& batch, int bounce) {
+	Parallel_For(batch.size(), [&](size_t first, size_t last, size_t) {
+		for (size_t k = first; k < last; k++) {
+			const int i = batch[k];
+			const Hit_Record& rec = recs[i];
+			const int path = sorted.path[i];
+			Colour throughput = sorted.throughput[i];
+			//	Folds away for the materials that never emit
+			const Colour emitted = Emitted_As<M>(*rec.mat_ptr);
+			if (emitted != Colour(0, 0, 0)) {
+				radiance[path] += throughput * emitted;
+			}
+			if (bounce >= max_depth) {
+				continue;
+			}
+			Colour attenuation;
+			Ray out;
+			if (!Scatter_As<M>(*rec.mat_ptr, sorted.Get(i), rec, attenuation, out)) {
+				continue;
+			}
+			throughput = throughput * attenuation;
+			if (Russian_Roulette(throughput, bounce)) {
+				rays.Set(i, path, out, throughput);
+				scattered[i] = 1;
+			}
+		}
+	});
+}
+
+//	Escaped rays pick up their path's background, the rest are binned by material type and
+//	shaded a batch at a time. Scattered rays are compacted into the next bounce's queue.
+void Wavefront_Integrator::Shade_Hits(int bounce) {
+	const size_t n = sorted.Size();
+	for (auto& batch : batches) {
+		batch.clear();
+	}
+	scattered.assign(n, 0);
+	for (size_t i = 0; i < n; i++) {
+		if (!hit[i]) {
+			const int path = sorted.path[i];
+			radiance[path] += sorted.throughput[i] * background[path];
+			continue;
+		}
+		int type = recs[i].mat_ptr->id;
+		if (type < LAMBERTIAN || type > DIFFUSE_LIGHT) {
+			type = MATERIAL;
+		}
+		batches[type].push_back(static_cast<int>(i));
+	}
+
+	rays.Resize(n);
+	Shade_Batch<Lambertian>(batches[LAMBERTIAN], bounce);
+	Shade_Batch<Metal>(batches[METAL], bounce);
+	Shade_Batch<Dielectric>(batches[DIELECTRIC], bounce);
+	Shade_Batch<Diffuse_Light>(batches[DIFFUSE_LIGHT], bounce);
+	Shade_Batch<Material>(batches[MATERIAL], bounce);
+
+	size_t live = 0;
+	for (size_t i = 0; i < n; i++) {
+		if (!scattered[i]) {
+			continue;
+		}
+		for (int a = 0; a < 3; a++) {
+			rays.origin[a][live] = rays.origin[a][i];
+			rays.dir[a][live] = rays.dir[a][i];
+		}
+		rays.path[live] = rays.path[i];
+		rays.throughput[live] = rays.throughput[i];
+		live++;
+	}
+	rays.Resize(live);
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "common.h"
+#include "enum.h"
+#include "hittable.h"
+#include "material.h"
+
+//	Rays of one bounce, structure of arrays. path is the index of the path each ray extends,
+//	throughput what the path has kept of its energy so far, both travel with the ray as the
+//	queue is sorted.
+struct Ray_Queue {
+	std::vector<float> origin[3];
+	std::vector<float> dir[3];
+	std::vector<int> path;
+	std::vector<Colour> throughput;
+
+	size_t Size() const { return path.size(); }
+	void Resize(size_t n);
+	void Set(size_t i, int ray_path, const Ray& r, const Colour& ray_throughput);
+	Ray Get(size_t i) const;
+};
+
+//	Breadth first alternative to Ray_Colour. Every path advances one bounce at a time: the
+//	bounce's rays are sorted by direction octant and origin so packets out of the queue stay
+//	coherent, traced with Hit_Packet, then shaded in one batch per material type.
+class Wavefront_Integrator {
+public:
+	Wavefront_Integrator(const Hittable& world, int max_depth) : world(world), max_depth(max_depth) {}
+
+	//	Starts a path, background is what it sees if it escapes at any bounce
+	void Add_Path(const Ray& r, const Colour& background);
+	//	Runs every path to the end, radiance[i] is then the sample of the i-th path added
+	void Trace();
+	void Clear();
+
+public:
+	std::vector<Colour> radiance;
+
+private:
+	void Sort_Rays();
+	void Trace_Rays();
+	void Shade_Hits(int bounce);
+	template<typename M>
+	void Shade_Batch(const std::vector<int>& batch, int bounce);
+
+private:
+	const Hittable& world;
+	int max_depth;
+
+	std::vector<Colour> background;
+
+	Ray_Queue rays;
+	Ray_Queue sorted;
+	std::vector<Hit_Record> recs;
+	std::vector<char> hit;
+	std::vector<char> scattered;
+	std::vector<int> batches[DIFFUSE_LIGHT + 1];
+	std::vector<uint16_t> keys;
+	std::vector<size_t> offsets;
+};
@@ -0,0 +1,549 @@
+#include "wide_bvh.h"
+#include "linear_bvh.h"
+#include "bvh.h"
+#include <future>
+#include <limits>
+#include <queue>
+#include <algorithm>
+#if defined(WIDE_BVH_SSE) || defined(WIDE_BVH_AVX)
+#include <immintrin.h>
+#endif
+
+inline bool Is_Interior(const std::shared_ptr<Hittable>& h) {
+	return h->Left() != nullptr && h->Left() != h->Right();
+}
+
+//	Near and far planes are picked per axis from the ray direction sign so empty lanes,
+//	whose min is +max and max is -max, always come out with t_near > t_far.
+template<int N>
+inline int Intersect_Children(const Wide_BVH_Node<N>& node, const float origin[3], const float inv_dir[3], const bool dir_is_neg[3],
+	float t_min, float t_max, float t_near[N]) {
+	const float* near_x = dir_is_neg[0] ? node.max_x : node.min_x;
+	const float* near_y = dir_is_neg[1] ? node.max_y : node.min_y;
+	const float* near_z = dir_is_neg[2] ? node.max_z : node.min_z;
+	const float* far_x = dir_is_neg[0] ? node.min_x : node.max_x;
+	const float* far_y = dir_is_neg[1] ? node.min_y : node.max_y;
+	const float* far_z = dir_is_neg[2] ? node.min_z : node.max_z;
+
+	int mask = 0;
+	for (int i = 0; i < N; i++) {
+		float t0 = t_min;
+		float t1 = t_max;
+		float tx0 = (near_x[i] - origin[0]) * inv_dir[0], tx1 = (far_x[i] - origin[0]) * inv_dir[0];
+		float ty0 = (near_y[i] - origin[1]) * inv_dir[1], ty1 = (far_y[i] - origin[1]) * inv_dir[1];
+		float tz0 = (near_z[i] - origin[2]) * inv_dir[2], tz1 = (far_z[i] - origin[2]) * inv_dir[2];
+		t0 = tx0 > t0 ? tx0 : t0;
+		t0 = ty0 > t0 ? ty0 : t0;
+		t0 = tz0 > t0 ? tz0 : t0;
+		t1 = tx1 < t1 ? tx1 : t1;
+		t1 = ty1 < t1 ? ty1 : t1;
+		t1 = tz1 < t1 ? tz1 : t1;
+		t_near[i] = t0;
+		mask |= (t0 <= t1) << i;
+	}
+	return mask;
+}
+
+#ifdef WIDE_BVH_SSE
+template<>
+inline int Intersect_Children<4>(const Wide_BVH_Node<4>& node, const float origin[3], const float inv_dir[3], const bool dir_is_neg[3],
+	float t_min, float t_max, float t_near[4]) {
+	const __m128 ox = _mm_set1_ps(origin[0]), oy = _mm_set1_ps(origin[1]), oz = _mm_set1_ps(origin[2]);
+	const __m128 ix = _mm_set1_ps(inv_dir[0]), iy = _mm_set1_ps(inv_dir[1]), iz = _mm_set1_ps(inv_dir[2]);
+
+	__m128 t0x = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(dir_is_neg[0] ? node.max_x : node.min_x), ox), ix);
+	__m128 t0y = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(dir_is_neg[1] ? node.max_y : node.min_y), oy), iy);
+	__m128 t0z = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(dir_is_neg[2] ? node.max_z : node.min_z), oz), iz);
+	__m128 t1x = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(dir_is_neg[0] ? node.min_x : node.max_x), ox), ix);
+	__m128 t1y = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(dir_is_neg[1] ? node.min_y : node.max_y), oy), iy);
+	__m128 t1z = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(dir_is_neg[2] ? node.min_z : node.max_z), oz), iz);
+
+	__m128 t0 = _mm_max_ps(_mm_max_ps(t0x, t0y), _mm_max_ps(t0z, _mm_set1_ps(t_min)));
+	__m128 t1 = _mm_min_ps(_mm_min_ps(t1x, t1y), _mm_min_ps(t1z, _mm_set1_ps(t_max)));
+	_mm_storeu_ps(t_near, t0);
+	return _mm_movemask_ps(_mm_cmple_ps(t0, t1));
+}
+#endif
+
+#ifdef WIDE_BVH_AVX
+template<>
+inline int Intersect_Children<8>(const Wide_BVH_Node<8>& node, const float origin[3], const float inv_dir[3], const bool dir_is_neg[3],
+	float t_min, float t_max, float t_near[8]) {
+	const __m256 ox = _mm256_set1_ps(origin[0]), oy = _mm256_set1_ps(origin[1]), oz = _mm256_set1_ps(origin[2]);
+	const __m256 ix = _mm256_set1_ps(inv_dir[0]), iy = _mm256_set1_ps(inv_dir[1]), iz = _mm256_set1_ps(inv_dir[2]);
+
+	__m256 t0x = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(dir_is_neg[0] ? node.max_x : node.min_x), ox), ix);
+	__m256 t0y = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(dir_is_neg[1] ? node.max_y : node.min_y), oy), iy);
+	__m256 t0z = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(dir_is_neg[2] ? node.max_z : node.min_z), oz), iz);
+	__m256 t1x = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(dir_is_neg[0] ? node.min_x : node.max_x), ox), ix);
+	__m256 t1y = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(dir_is_neg[1] ? node.min_y : node.max_y), oy), iy);
+	__m256 t1z = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(dir_is_neg[2] ? node.min_z : node.max_z), oz), iz);
+
+	__m256 t0 = _mm256_max_ps(_mm256_max_ps(t0x, t0y), _mm256_max_ps(t0z, _mm256_set1_ps(t_min)));
+	__m256 t1 = _mm256_min_ps(_mm256_min_ps(t1x, t1y), _mm256_min_ps(t1z, _mm256_set1_ps(t_max)));
+	_mm256_storeu_ps(t_near, t0);
+	return _mm256_movemask_ps(_mm256_cmp_ps(t0, t1, _CMP_LE_OQ));
+}
+#endif
+
+template<int N>
+inline AABB Lane_Box(const Wide_BVH_Node<N>& node, int i) {
+	return AABB(Point3f(node.min_x[i], node.min_y[i], node.min_z[i]), Point3f(node.max_x[i], node.max_y[i], node.max_z[i]));
+}
+
+template<int N>
+inline void Set_Lane_Box(Wide_BVH_Node<N>& node, int i, const AABB& box) {
+	node.min_x[i] = box.Min().x; node.min_y[i] = box.Min().y; node.min_z[i] = box.Min().z;
+	node.max_x[i] = box.Max().x; node.max_y[i] = box.Max().y; node.max_z[i] = box.Max().z;
+}
+
+template<int N>
+inline Wide_BVH_Node<N> Empty_Node() {
+	Wide_BVH_Node<N> node;
+	const float big = std::numeric_limits<float>::max();
+	for (int i = 0; i < N; i++) {
+		node.min_x[i] = node.min_y[i] = node.min_z[i] = big;
+		node.max_x[i] = node.max_y[i] = node.max_z[i] = -big;
+		node.child[i] = 0;
+		node.count[i] = 0;
+	}
+	return node;
+}
+
+template<int N>
+Wide_BVH<N>::Wide_BVH(std::shared_ptr<Hittable> root, int order) : node_order(order) {
+	Build(root);
+	Reorder(order);
+}
+
+template<int N>
+void Wide_BVH<N>::Build(const std::shared_ptr<Hittable>& root) {
+	root->Bounding_Box(bounds);
+	if (Is_Interior(root)) {
+		//	The stacks below hold N - 1 entries per level, so a binary tree within BVH_STACK_SIZE fits
+		Collapse(Limit_Height(root, BVH_STACK_SIZE));
+		build_cost = SAH_Cost();
+		return;
+	}
+
+	//	A single primitive still gets a node so Hit has one code path
+	Wide_BVH_Node<N> node = Empty_Node<N>();
+	Set_Lane_Box(node, 0, bounds);
+	node.child[0] = ~0;
+	node.count[0] = 1;
+	primitives.push_back(root->Left() == nullptr ? root : root->Left());
+	nodes.push_back(node);
+	build_cost = SAH_Cost();
+}
+
+template<int N>
+int Wide_BVH<N>::Collapse(const std::shared_ptr<Hittable>& n) {
+	int offset = static_cast<int>(nodes.size());
+	nodes.emplace_back();
+
+	//	Keep opening the largest interior child until all N slots are used
+	std::vector<std::shared_ptr<Hittable>> children = { n->Left(), n->Right() };
+	while (children.size() < N) {
+		int best = -1;
+		float best_area = -1.F;
+		for (size_t i = 0; i < children.size(); i++) {
+			if (!Is_Interior(children[i])) {
+				continue;
+			}
+			AABB box;
+			children[i]->Bounding_Box(box);
+			if (box.Surface_Area() > best_area) {
+				best_area = box.Surface_Area();
+				best = static_cast<int>(i);
+			}
+		}
+		if (best == -1) {
+			break;
+		}
+		std::shared_ptr<Hittable> opened = children[best];
+		children[best] = opened->Left();
+		children.push_back(opened->Right());
+	}
+
+	Wide_BVH_Node<N> node = Empty_Node<N>();
+
+	for (size_t i = 0; i < children.size(); i++) {
+		AABB box;
+		children[i]->Bounding_Box(box);
+		Set_Lane_Box(node, static_cast<int>(i), box);
+
+		if (Is_Interior(children[i])) {
+			node.child[i] = Collapse(children[i]);
+		}
+		else {
+			//	One primitive per leaf on purpose, a lane is as cheap to test as a virtual Hit,
+			//	so grouping primitives would only trade box tests for more primitive tests
+			node.child[i] = ~static_cast<int>(primitives.size());
+			node.count[i] = 1;
+			primitives.push_back(children[i]->Left() == nullptr ? children[i] : children[i]->Left());
+		}
+	}
+	nodes[offset] = node;
+	return offset;
+}
+
+template<int N>
+bool Wide_BVH<N>::Hit(const Ray& r, double t_min, double t_max, Hit_Record& rec) const {
+	const Point3f o = r.Origin();
+	const Vec3f d = r.Direction();
+	const float origin[3] = { o.x, o.y, o.z };
+	const float inv_dir[3] = { 1.F / d.x, 1.F / d.y, 1.F / d.z };
+	const bool dir_is_neg[3] = { inv_dir[0] < 0, inv_dir[1] < 0, inv_dir[2] < 0 };
+
+	struct Stack_Entry {
+		int node;
+		float t;
+	};
+	Stack_Entry to_visit[BVH_STACK_SIZE * N];
+	int to_visit_offset = 0;
+	to_visit[to_visit_offset++] = { 0, static_cast<float>(t_min) };
+
+	bool hit_anything = false;
+	double closest_so_far = t_max;
+
+	while (to_visit_offset > 0) {
+		const Stack_Entry entry = to_visit[--to_visit_offset];
+		if (entry.t > closest_so_far) {
+			continue;
+		}
+		const Wide_BVH_Node<N>& node = nodes[entry.node];
+
+		float t_near[N];
+		int mask = Intersect_Children<N>(node, origin, inv_dir, dir_is_neg, static_cast<float>(t_min), static_cast<float>(closest_so_far), t_near);
+
+		//	Leaves are intersected straight away near to far so a close hit can skip the rest,
+		//	which matters when a leaf is a whole instanced tree. Interior children are pushed far to near.
+		int interior[N];
+		int leaves[N];
+		int n_interior = 0;
+		int n_leaves = 0;
+		for (int i = 0; i < N; i++) {
+			if (!(mask & (1 << i))) {
+				continue;
+			}
+			if (node.child[i] >= 0) {
+				int j = n_interior++;
+				while (j > 0 && t_near[interior[j - 1]] < t_near[i]) {
+					interior[j] = interior[j - 1];
+					j--;
+				}
+				interior[j] = i;
+				continue;
+			}
+			int j = n_leaves++;
+			while (j > 0 && t_near[leaves[j - 1]] > t_near[i]) {
+				leaves[j] = leaves[j - 1];
+				j--;
+			}
+			leaves[j] = i;
+		}
+		for (int i = 0; i < n_leaves; i++) {
+			if (t_near[leaves[i]] > closest_so_far) {
+				break;
+			}
+			int first = ~node.child[leaves[i]];
+			for (int p = first; p < first + node.count[leaves[i]]; p++) {
+				if (primitives[p]->Hit(r, t_min, closest_so_far, rec)) {
+					hit_anything = true;
+					closest_so_far = rec.t;
+				}
+			}
+		}
+		for (int i = 0; i < n_interior; i++) {
+			if (t_near[interior[i]] <= closest_so_far) {
+				to_visit[to_visit_offset++] = { node.child[interior[i]], t_near[interior[i]] };
+			}
+		}
+	}
+	return hit_anything;
+}
+
+template<int N>
+bool Wide_BVH<N>::Occluded(const Ray& r, double t_min, double t_max) const {
+	const Point3f o = r.Origin();
+	const Vec3f d = r.Direction();
+	const float origin[3] = { o.x, o.y, o.z };
+	const float inv_dir[3] = { 1.F / d.x, 1.F / d.y, 1.F / d.z };
+	const bool dir_is_neg[3] = { inv_dir[0] < 0, inv_dir[1] < 0, inv_dir[2] < 0 };
+
+	//	Any hit ends the query so children are visited in lane order without sorting
+	int to_visit[BVH_STACK_SIZE * N];
+	int to_visit_offset = 0;
+	to_visit[to_visit_offset++] = 0;
+
+	while (to_visit_offset > 0) {
+		const Wide_BVH_Node<N>& node = nodes[to_visit[--to_visit_offset]];
+
+		float t_near[N];
+		int mask = Intersect_Children<N>(node, origin, inv_dir, dir_is_neg, static_cast<float>(t_min), static_cast<float>(t_max), t_near);
+		for (int i = 0; i < N; i++) {
+			if (!(mask & (1 << i))) {
+				continue;
+			}
+			if (node.child[i] >= 0) {
+				to_visit[to_visit_offset++] = node.child[i];
+				continue;
+			}
+			int first = ~node.child[i];
+			for (int p = first; p < first + node.count[i]; p++) {
+				if (primitives[p]->Occluded(r, t_min, t_max)) {
+					return true;
+				}
+			}
+		}
+	}
+	return false;
+}
+
+template<int N>
+bool Wide_BVH<N>::Bounding_Box(AABB& output_box) const {
+	output_box = bounds;
+	return true;
+}
+
+template<int N>
+float Wide_BVH<N>::SAH_Cost() const {
+	float root_area = bounds.Surface_Area();
+	if (root_area <= 0) {
+		return 0.F;
+	}
+	float cost = SAH_TRAVERSAL_COST;
+	for (const auto& node : nodes) {
+		for (int i = 0; i < N; i++) {
+			if (node.child[i] == 0) {
+				continue;
+			}
+			float area = Lane_Box(node, i).Surface_Area() / root_area;
+			cost += node.child[i] > 0 ? area * SAH_TRAVERSAL_COST : area * node.count[i] * SAH_INTERSECT_COST;
+		}
+	}
+	return cost;
+}
+
+//	Parallel_Build_Depth counts binary levels, one wide level already fans out N ways, so this
+//	spawns about as many tasks as there are threads rather than N^depth
+template<int N>
+static int Parallel_Refit_Depth() {
+	int log2_n = 0;
+	for (int n = N; n > 1; n >>= 1) {
+		log2_n++;
+	}
+	return (Parallel_Build_Depth() - 1 + log2_n - 1) / log2_n;
+}
+
+//	Empty lanes are the only ones with child 0, the root is never anyone's child
+template<int N>
+AABB Wide_BVH<N>::Refit_Node(int index, int parallel_depth) {
+	std::future<AABB> tasks[N];
+	AABB box = Empty_Box();
+
+	for (int i = 0; i < N; i++) {
+		const Wide_BVH_Node<N>& node = nodes[index];
+		if (node.child[i] > 0 && parallel_depth > 0) {
+			tasks[i] = std::async(std::launch::async, &Wide_BVH<N>::Refit_Node, this, node.child[i], parallel_depth - 1);
+		}
+	}
+	for (int i = 0; i < N; i++) {
+		Wide_BVH_Node<N>& node = nodes[index];
+		AABB lane = Empty_Box();
+		if (node.child[i] == 0) {
+			continue;
+		}
+		else if (node.child[i] > 0) {
+			lane = tasks[i].valid() ? tasks[i].get() : Refit_Node(node.child[i], 0);
+		}
+		else {
+			int first = ~node.child[i];
+			for (int p = first; p < first + node.count[i]; p++) {
+				AABB prim_box;
+				primitives[p]->Bounding_Box(prim_box);
+				lane = Enclosing_Box(lane, prim_box);
+			}
+		}
+		Set_Lane_Box(node, i, lane);
+		box = Enclosing_Box(box, lane);
+	}
+	return Surrounding_Box(box, box);
+}
+
+template<int N>
+bool Wide_BVH<N>::Refit(float rebuild_threshold) {
+	bounds = Refit_Node(0, Parallel_Refit_Depth<N>());
+
+	if (rebuild_threshold <= 0 || SAH_Cost() <= rebuild_threshold * build_cost) {
+		return false;
+	}
+	std::shared_ptr<Hittable> root = std::make_shared<BVH_Node>(Unique_Objects(primitives));
+	nodes.clear();
+	primitives.clear();
+	Build(root);
+	Reorder(node_order);
+	return true;
+}
+
+//	Lanes from most to least likely to be entered, surface area standing in for the odds
+template<int N>
+inline void Lanes_By_Area(const Wide_BVH_Node<N>& node, int lanes[N], int& count) {
+	float area[N];
+	count = 0;
+	for (int i = 0; i < N; i++) {
+		if (node.child[i] == 0) {
+			continue;
+		}
+		area[i] = Lane_Box(node, i).Surface_Area();
+		int j = count++;
+		while (j > 0 && area[lanes[j - 1]] < area[i]) {
+			lanes[j] = lanes[j - 1];
+			j--;
+		}
+		lanes[j] = i;
+	}
+}
+
+template<int N>
+void Wide_BVH<N>::Order_Hot_Child(int index, std::vector<int>& order) const {
+	order.push_back(index);
+	int lanes[N];
+	int count;
+	Lanes_By_Area(nodes[index], lanes, count);
+	for (int i = 0; i < count; i++) {
+		if (nodes[index].child[lanes[i]] > 0) {
+			Order_Hot_Child(nodes[index].child[lanes[i]], order);
+		}
+	}
+}
+
+//	Grows page sized treelets from the root, always adding the largest node on the frontier,
+//	then starts a new treelet at each node left on the frontier
+template<int N>
+void Wide_BVH<N>::Order_Treelets(std::vector<int>& order) const {
+	const size_t treelet_size = std::max<size_t>(1, 4096 / sizeof(Wide_BVH_Node<N>));
+
+	struct Candidate {
+		float area;
+		int node;
+		bool operator<(const Candidate& rhs) const { return area < rhs.area; }
+	};
+
+	std::vector<int> roots = { 0 };
+	while (!roots.empty()) {
+		int root = roots.back();
+		roots.pop_back();
+
+		std::priority_queue<Candidate> frontier;
+		frontier.push({ 0.F, root });
+		std::vector<int> cut;
+		size_t taken = 0;
+		while (!frontier.empty()) {
+			int index = frontier.top().node;
+			frontier.pop();
+			if (taken == treelet_size) {
+				cut.push_back(index);
+				continue;
+			}
+			order.push_back(index);
+			taken++;
+			for (int i = 0; i < N; i++) {
+				if (nodes[index].child[i] > 0) {
+					frontier.push({ Lane_Box(nodes[index], i).Surface_Area(), nodes[index].child[i] });
+				}
+			}
+		}
+		//	Smallest first onto the stack so the largest treelet is laid out next
+		std::reverse(cut.begin(), cut.end());
+		roots.insert(roots.end(), cut.begin(), cut.end());
+	}
+}
+
+template<int N>
+int Wide_BVH<N>::Height(int index) const {
+	int height = 0;
+	for (int i = 0; i < N; i++) {
+		if (nodes[index].child[i] > 0) {
+			height = std::max(height, Height(nodes[index].child[i]));
+		}
+	}
+	return height + 1;
+}
+
+//	The top half of the levels is laid out recursively, then each subtree hanging below it
+template<int N>
+void Wide_BVH<N>::Order_Van_Emde_Boas(int index, int levels, std::vector<int>& order) const {
+	if (levels == 1) {
+		order.push_back(index);
+		return;
+	}
+	int top = levels / 2;
+	Order_Van_Emde_Boas(index, top, order);
+
+	std::vector<int> level = { index };
+	for (int depth = 0; depth < top; depth++) {
+		std::vector<int> next;
+		for (int n : level) {
+			for (int i = 0; i < N; i++) {
+				if (nodes[n].child[i] > 0) {
+					next.push_back(nodes[n].child[i]);
+				}
+			}
+		}
+		level.swap(next);
+	}
+	for (int n : level) {
+		Order_Van_Emde_Boas(n, levels - top, order);
+	}
+}
+
+template<int N>
+void Wide_BVH<N>::Reorder(int order) {
+	node_order = order;
+	if (order == DEPTH_FIRST_ORDER) {
+		return;
+	}
+
+	std::vector<int> sequence;
+	sequence.reserve(nodes.size());
+	if (order == HOT_CHILD_ORDER) {
+		Order_Hot_Child(0, sequence);
+	}
+	else if (order == TREELET_ORDER) {
+		Order_Treelets(sequence);
+	}
+	else if (order == VAN_EMDE_BOAS_ORDER) {
+		Order_Van_Emde_Boas(0, Height(0), sequence);
+	}
+
+	std::vector<int> new_index(nodes.size());
+	for (size_t i = 0; i < sequence.size(); i++) {
+		new_index[sequence[i]] = static_cast<int>(i);
+	}
+
+	//	Primitives are repacked in the new node order so leaf loads follow the nodes
+	std::vector<Wide_BVH_Node<N>> reordered;
+	std::vector<std::shared_ptr<Hittable>> packed;
+	reordered.reserve(nodes.size());
+	packed.reserve(primitives.size());
+	for (int old_index : sequence) {
+		Wide_BVH_Node<N> node = nodes[old_index];
+		for (int i = 0; i < N; i++) {
+			if (node.child[i] > 0) {
+				node.child[i] = new_index[node.child[i]];
+			}
+			else if (node.child[i] < 0) {
+				int first = ~node.child[i];
+				node.child[i] = ~static_cast<int>(packed.size());
+				packed.insert(packed.end(), primitives.begin() + first, primitives.begin() + first + node.count[i]);
+			}
+		}
+		reordered.push_back(node);
+	}
+	nodes.swap(reordered);
+	primitives.swap(packed);
+}
+
+template class Wide_BVH<4>;
+template class Wide_BVH<8>;
\ No newline at end of file
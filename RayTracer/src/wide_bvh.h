@@ -0,0 +1,60 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "hittable.h"
+#include "enum.h"
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define WIDE_BVH_SSE
+#endif
+#if defined(__AVX__)
+#define WIDE_BVH_AVX
+#endif
+
+//	N child boxes stored as structure of arrays so one node is tested with a few vector ops.
+//	child >= 0 is an interior node index, child < 0 a leaf holding primitives [~child, ~child + count).
+template<int N>
+struct Wide_BVH_Node {
+	float min_x[N], min_y[N], min_z[N];
+	float max_x[N], max_y[N], max_z[N];
+	int child[N];
+	uint16_t count[N];
+};
+
+template<int N>
+class Wide_BVH : public Hittable {
+public:
+	Wide_BVH(std::shared_ptr<Hittable> root, int order = DEPTH_FIRST_ORDER);
+
+	virtual bool Hit(const Ray& r, double t_min, double t_max, Hit_Record& rec) const override;
+	virtual bool Bounding_Box(AABB& output_box) const override;
+	virtual bool Occluded(const Ray& r, double t_min, double t_max) const override;
+
+	//	Same contract as Linear_BVH::Refit
+	bool Refit(float rebuild_threshold = 0.F);
+	float SAH_Cost() const;
+
+	//	Moves nodes and primitives in memory so ones likely to be traversed together share
+	//	cache lines and pages. Traversal is the same for every order.
+	void Reorder(int order);
+
+public:
+	std::vector<Wide_BVH_Node<N>> nodes;
+	std::vector<std::shared_ptr<Hittable>> primitives;
+	AABB bounds;
+	float build_cost;
+	int node_order;
+
+private:
+	void Build(const std::shared_ptr<Hittable>& root);
+	int Collapse(const std::shared_ptr<Hittable>& n);
+	void Order_Hot_Child(int index, std::vector<int>& order) const;
+	void Order_Treelets(std::vector<int>& order) const;
+	void Order_Van_Emde_Boas(int index, int levels, std::vector<int>& order) const;
+	int Height(int index) const;
+	AABB Refit_Node(int index, int parallel_depth);
+};
+
+typedef Wide_BVH<4> BVH4;
+typedef Wide_BVH<8> BVH8;
\ No newline at end of file